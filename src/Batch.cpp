@@ -0,0 +1,246 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Batch.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to solve many
+ * circuit files in a single run of the program.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include "Batch.h"
+#include "CircuitFile.h"
+#include "Log.h"
+#include "Parallel.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+    /*!
+    * \brief Function that tells if a name matches a pattern with * and ? wildcards.
+    */
+    bool matchPattern(const string &name, const string &pattern) {
+        // Greedy match that goes back to the last * when a character does not match
+        size_t n = 0, p = 0, star = string::npos, resume = 0;
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                n++;
+                p++;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                resume = n;
+            } else if (star != string::npos) {
+                p = star + 1;
+                n = ++resume;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*')
+            p++;
+        return p == pattern.size();
+    }
+
+    /*!
+    * \brief Function that tells if a file is a circuit file a batch can take.
+    */
+    bool isCircuitFile(const fs::path &file, bool compile) {
+        string extension = file.extension().string();
+        return extension == ".xml" || (!compile && extension == ".csb");
+    }
+
+    /*!
+    * \brief Function that adds the circuit files of an input to a list.
+    * 
+    * \return true if the input matches some file, false otherwise
+    */
+    bool addInput(const string &input, const fs::path &folder, bool compile, vector<fs::path> &files,
+        vector<string> &missing) {
+        error_code error;
+
+        // A manifest lists other inputs
+        if (!input.empty() && input[0] == '@') {
+            fs::path manifest = folder / input.substr(1);
+            ifstream stream(manifest);
+            if (!stream)
+                return false;
+            string line;
+            while (getline(stream, line)) {
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                line.erase(0, line.find_first_not_of(" \t"));
+                if (!line.empty() && line[0] != '#' && !addInput(line, manifest.parent_path(), compile, files, missing))
+                    missing.push_back(line);
+            }
+            return true;
+        }
+
+        // A directory gives its circuit files
+        fs::path path = folder / input;
+        if (fs::is_directory(path, error)) {
+            for (const fs::directory_entry &entry : fs::directory_iterator(path, error)) {
+                if (entry.is_regular_file(error) && isCircuitFile(entry.path(), compile))
+                    files.push_back(entry.path());
+            }
+            return true;
+        }
+
+        // A pattern gives the circuit files of its folder whose name matches it
+        string pattern = path.filename().string();
+        if (pattern.find_first_of("*?") != string::npos) {
+            fs::path parent = path.has_parent_path() ? path.parent_path() : fs::path(".");
+            size_t found = files.size();
+            for (const fs::directory_entry &entry : fs::directory_iterator(parent, error)) {
+                if (entry.is_regular_file(error) && isCircuitFile(entry.path(), compile) &&
+                    matchPattern(entry.path().filename().string(), pattern))
+                    files.push_back(entry.path());
+            }
+            return files.size() > found;
+        }
+
+        if (!fs::is_regular_file(path, error))
+            return false;
+        files.push_back(path);
+        return true;
+    }
+
+    /*!
+    * \brief Function that reads, solves and writes a circuit file, or compiles it.
+    * 
+    * \return true if it was done, false otherwise
+    */
+    bool solveFile(const string &fileName, const BatchOptions &options) {
+        CircuitContext context;
+        context.engine = options.engine;
+        context.deferResults = !options.results.probeIDs.empty() && options.results.format != "binary";
+        if (!loadCircuit(fileName, context))
+            return false;
+
+        if (options.compile) {
+            string compiled_file_name = fileName.substr(0, fileName.length() - 4) + ".csb";
+            if (!compileCircuit(context.view(), compiled_file_name)) {
+                logMessage(LogLevel::Error, "ERROR: There were problems writing ", compiled_file_name);
+                return false;
+            }
+            return true;
+        }
+
+        if (!solveCircuit(context)) {
+            logMessage(LogLevel::Error, "ERROR: The circuit ", fileName, " can't be solved, its impedance matrix is singular");
+            return false;
+        }
+        string results_file_name = resultsFileName(fileName, options.results.format);
+        if (!saveResults(context, options.results, results_file_name)) {
+            logMessage(LogLevel::Error, "ERROR: There were problems writing ", results_file_name);
+            return false;
+        }
+        logMessage(LogLevel::Verbose, "Results of ", fileName, " saved to ", results_file_name);
+        return true;
+    }
+}
+
+
+vector<string> findCircuitFiles(const vector<string> &inputs, bool compile, vector<string> &missing) {
+    vector<fs::path> paths;
+    for (const string &input : inputs) {
+        if (!addInput(input, fs::path(), compile, paths, missing))
+            missing.push_back(input);
+    }
+
+    // Take each circuit once, and the newest of its XML and compiled files
+    unordered_map<string, size_t> circuits;
+    vector<pair<uintmax_t, string>> files;
+    vector<fs::file_time_type> times;
+    for (const fs::path &path : paths) {
+        error_code error;
+        string name = path.lexically_normal().string();
+        string stem = name.substr(0, name.length() - 4);
+        uintmax_t size = fs::file_size(path, error);
+        if (error)
+            size = 0;
+        fs::file_time_type time = fs::last_write_time(path, error);
+        if (error)
+            time = fs::file_time_type::min();
+        auto found = circuits.find(stem);
+        if (found == circuits.end()) {
+            circuits.emplace(stem, files.size());
+            files.emplace_back(size, name);
+            times.push_back(time);
+            continue;
+        }
+        pair<uintmax_t, string> &file = files[found->second];
+        if (file.second == name)
+            continue;
+        // The compiled file is taken unless the XML file was changed after compiling it
+        bool compiled = path.extension() == ".csb";
+        bool newer = compiled ? time >= times[found->second] : time > times[found->second];
+        const string &stale = newer ? file.second : name;
+        if (stale.compare(stale.length() - 4, 4, ".csb") == 0)
+            logMessage(LogLevel::Error, "WARNING: ", stale, " is older than its XML file, which is solved instead");
+        if (newer) {
+            file = {size, name};
+            times[found->second] = time;
+        }
+    }
+
+    // Largest circuits first
+    stable_sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first;
+    });
+    vector<string> names;
+    names.reserve(files.size());
+    for (auto &file : files)
+        names.push_back(move(file.second));
+    return names;
+}
+
+
+int solveBatch(const vector<string> &inputs, const BatchOptions &options) {
+    auto begin = chrono::steady_clock::now();
+    vector<string> missing;
+    vector<string> files = findCircuitFiles(inputs, options.compile, missing);
+    for (const string &input : missing)
+        logMessage(LogLevel::Error, "ERROR: There is no circuit file matching ", input);
+    if (files.empty()) {
+        logMessage(LogLevel::Error, "ERROR: The batch has no circuit files");
+        return EXIT_FAILURE;
+    }
+
+    // Each thread runs whole circuits, and steals them from the others when it runs out
+    atomic<size_t> done(0);
+    parallelTasks(files.size(), threadCount(files.size(), 1), [&](size_t i, unsigned) {
+        if (solveFile(files[i], options))
+            done.fetch_add(1, memory_order_relaxed);
+    });
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    size_t failed = files.size() - done.load();
+    logMessage(LogLevel::Info, "\n", options.compile ? "Compiled " : "Solved ", done.load(), " of ", files.size(),
+        " circuits in ", elapsed, " seconds");
+    if (failed > 0)
+        logMessage(LogLevel::Error, "ERROR: ", failed, " circuits failed");
+    return failed == 0 && missing.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
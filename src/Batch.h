@@ -0,0 +1,80 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Batch.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to solve many
+ * circuit files in a single run of the program.
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include "CircuitSolver.h"
+
+
+/*!
+ * \brief What a batch does with each circuit file.
+ */
+struct BatchOptions {
+    bool compile = false;                       // true to compile the XML files instead of solving them
+    SolverEngine engine = SolverEngine::Auto;   // The method used to solve the circuits
+    ResultsOptions results;                     // The format and the results written for each circuit
+};
+
+/*!
+* \brief Function that finds the circuit files of a batch.
+* 
+* Each input may be a circuit file, a directory, whose XML and compiled files are
+* taken, a file name pattern, in which * stands for any characters and ? for one
+* character, or a manifest, written as @ followed by the name of a text file with an
+* input per line. The lines of a manifest that are empty or start with # are skipped,
+* and relative names are taken from the folder of the manifest.
+* 
+* A file is only taken once, and when both the XML and the compiled file of a circuit
+* are found, only the compiled one is solved, as they would write the same results,
+* unless the XML file was changed after compiling it. Then the XML file is solved, with
+* a warning. When compiling, only XML files are taken.
+* 
+* \param t_inputs The inputs of the batch
+* \param t_compile true if the files are going to be compiled
+* \param t_missing The inputs that match no file
+* 
+* \return The circuit files, sorted from the largest to the smallest
+*/
+std::vector<std::string> findCircuitFiles(const std::vector<std::string> &t_inputs, bool t_compile,
+    std::vector<std::string> &t_missing);
+
+/*!
+* \brief Function that solves or compiles many circuit files.
+* 
+* Each circuit is read, solved and written on its own by one of the threads of a
+* work-stealing pool, which starts with the largest circuits so that the small ones
+* fill the gaps at the end. The parallel loops of each circuit run on the same threads
+* as the batch, so they don't start threads of their own. Each results file is named after its circuit file, as in a
+* single run. A summary is written when every circuit is done, and the program never
+* waits for the user.
+* 
+* \param t_inputs The inputs of the batch, as described in findCircuitFiles
+* \param t_options What is done with each circuit
+* 
+* \return EXIT_SUCCESS if every input was found and every circuit was solved,
+* EXIT_FAILURE otherwise
+*/
+int solveBatch(const std::vector<std::string> &t_inputs, const BatchOptions &t_options);
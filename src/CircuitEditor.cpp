@@ -0,0 +1,269 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitEditor.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the circuit editor.
+ */
+
+#include <algorithm>
+#include "CircuitEditor.h"
+
+using namespace std;
+
+
+CircuitEditor::CircuitEditor(CircuitContext &context) : m_context(context) {
+    // A compiled circuit is read-only, so it is edited as a model
+    if (m_context.isCompiled) {
+        m_context.model.copyFrom(m_context.compiled.view());
+        m_context.isCompiled = false;
+    }
+    CircuitView circuit = m_context.view();
+
+    // Reuse the mesh system if the circuit was solved with mesh analysis
+    System &system = m_context.system;
+    if (system.impedanceMatrix.dim != static_cast<int>(circuit.meshCount) ||
+        system.voltages.size() != circuit.meshCount) {
+        system = createSystem(circuit);
+        m_context.dirtyColumn = 0;
+    }
+    m_solved = m_context.dirtyColumn >= system.impedanceMatrix.dim && !m_context.factorization.singular &&
+        m_context.factorization.L.dim == system.impedanceMatrix.dim &&
+        m_context.results.meshCurrents.size() == circuit.meshCount;
+
+    // List the meshes that traverse each branch
+    m_branchMeshes.assign(circuit.branchCount, {});
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++)
+            m_branchMeshes[circuit.meshBranchIndices[k]].emplace_back(i, circuit.meshBranchSigns[k]);
+    }
+}
+
+
+void CircuitEditor::addBranchImpedance(uint32_t branch) {
+    // The element of every pair of meshes which share the branch is added up again
+    // from the model before solving
+    for (const auto &column : m_branchMeshes[branch]) {
+        for (const auto &row : m_branchMeshes[branch])
+            m_changedEntries.emplace_back(row.first, column.first);
+        m_context.dirtyColumn = min(m_context.dirtyColumn, static_cast<int>(column.first));
+    }
+}
+
+
+void CircuitEditor::updateImpedances() {
+    sort(m_changedEntries.begin(), m_changedEntries.end());
+    m_changedEntries.erase(unique(m_changedEntries.begin(), m_changedEntries.end()), m_changedEntries.end());
+    CircuitView circuit = m_context.view();
+    for (const auto &entry : m_changedEntries) {
+        // Add the impedance of every branch of the row mesh that the column mesh also
+        // traverses, with the sign of both orientations
+        uint32_t i = entry.first;
+        double impedance = 0.0;
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++) {
+            uint32_t b = circuit.meshBranchIndices[k];
+            for (const auto &mesh : m_branchMeshes[b]) {
+                if (mesh.first != entry.second)
+                    continue;
+                double branch_impedance = 0.0;
+                for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+                    if (circuit.elementKinds[e] == ElementKind::Resistance)
+                        branch_impedance += circuit.elementValues[e];
+                }
+                impedance += circuit.meshBranchSigns[k] * mesh.second * branch_impedance;
+            }
+        }
+        setElement(m_context.system.impedanceMatrix, static_cast<int>(entry.first), static_cast<int>(entry.second),
+            impedance);
+    }
+    m_changedEntries.clear();
+}
+
+
+void CircuitEditor::addBranchVoltage(uint32_t branch) {
+    // The voltages of the meshes are added up again from the model before solving
+    for (const auto &mesh : m_branchMeshes[branch])
+        m_changedMeshes.push_back(mesh.first);
+}
+
+
+void CircuitEditor::updateVoltages() {
+    sort(m_changedMeshes.begin(), m_changedMeshes.end());
+    m_changedMeshes.erase(unique(m_changedMeshes.begin(), m_changedMeshes.end()), m_changedMeshes.end());
+    CircuitView circuit = m_context.view();
+    for (uint32_t i : m_changedMeshes) {
+        double voltage = 0.0;
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++) {
+            uint32_t b = circuit.meshBranchIndices[k];
+            double branch_voltage = 0.0;
+            for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+                if (circuit.elementKinds[e] == ElementKind::Battery)
+                    branch_voltage += circuit.elementValues[e];
+            }
+            voltage += circuit.meshBranchSigns[k] * branch_voltage;
+        }
+        m_context.system.voltages[i] = voltage;
+    }
+    m_changedMeshes.clear();
+}
+
+
+void CircuitEditor::addElementValue(uint32_t branch, ElementKind kind, double value) {
+    if (value == 0.0)
+        return;
+    if (kind == ElementKind::Resistance)
+        addBranchImpedance(branch);
+    else
+        addBranchVoltage(branch);
+}
+
+
+bool CircuitEditor::setValue(string_view elementID, double value) {
+    CircuitModel &model = m_context.model;
+    uint32_t element = model.findElement(elementID);
+    if (element == NOT_FOUND) {
+        m_error = "The element " + string(elementID) + " does not exist";
+        return false;
+    }
+    setElementValue(element, value);
+    return true;
+}
+
+
+void CircuitEditor::setElementValue(uint32_t element, double value) {
+    CircuitModel &model = m_context.model;
+    CircuitView circuit = model.view();
+    addElementValue(model.elementBranch(element), circuit.elementKinds[element],
+        value - circuit.elementValues[element]);
+    model.setElementValue(element, value);
+}
+
+
+bool CircuitEditor::addElement(string_view branchID, string_view elementID, ElementKind kind, double value) {
+    CircuitModel &model = m_context.model;
+    uint32_t branch = model.findBranch(branchID);
+    if (branch == NOT_FOUND) {
+        m_error = "The branch " + string(branchID) + " does not exist";
+        return false;
+    }
+    if (model.findElement(elementID) != NOT_FOUND) {
+        m_error = "The element " + string(elementID) + " already exists";
+        return false;
+    }
+    model.insertElement(branch, elementID, kind, value);
+    addElementValue(branch, kind, value);
+    return true;
+}
+
+
+bool CircuitEditor::removeElement(string_view elementID) {
+    CircuitModel &model = m_context.model;
+    uint32_t element = model.findElement(elementID);
+    if (element == NOT_FOUND) {
+        m_error = "The element " + string(elementID) + " does not exist";
+        return false;
+    }
+    CircuitView circuit = model.view();
+    addElementValue(model.elementBranch(element), circuit.elementKinds[element], -circuit.elementValues[element]);
+    model.removeElement(element);
+    return true;
+}
+
+
+bool CircuitEditor::addBranch(string_view branchID, const vector<pair<string, int>> &meshes) {
+    CircuitModel &model = m_context.model;
+    if (model.findBranch(branchID) != NOT_FOUND) {
+        m_error = "The branch " + string(branchID) + " already exists";
+        return false;
+    }
+    for (const auto &mesh : meshes) {
+        if (model.findMesh(mesh.first) == NOT_FOUND) {
+            m_error = "The mesh " + mesh.first + " does not exist";
+            return false;
+        }
+    }
+
+    // The branch has no elements yet, so the system does not change
+    model.clearNodes();
+    uint32_t branch = model.addBranch(branchID);
+    m_context.system.branchMeshes = {};
+    m_branchMeshes.emplace_back();
+    for (const auto &mesh : meshes) {
+        uint32_t i = model.findMesh(mesh.first);
+        int sign = mesh.second < 0 ? -1 : 1;
+        model.insertMeshBranch(i, branch, sign);
+        m_branchMeshes[branch].emplace_back(i, sign);
+    }
+    return true;
+}
+
+
+bool CircuitEditor::removeBranch(string_view branchID) {
+    CircuitModel &model = m_context.model;
+    uint32_t branch = model.findBranch(branchID);
+    if (branch == NOT_FOUND) {
+        m_error = "The branch " + string(branchID) + " does not exist";
+        return false;
+    }
+
+    // Take the elements of the branch out of the system
+    CircuitView circuit = model.view();
+    for (uint32_t e = circuit.branchElementOffsets[branch]; e < circuit.branchElementOffsets[branch + 1]; e++)
+        addElementValue(branch, circuit.elementKinds[e], -circuit.elementValues[e]);
+
+    model.clearNodes();
+    model.removeBranch(branch);
+    m_context.system.branchMeshes = {};
+    m_branchMeshes.erase(m_branchMeshes.begin() + branch);
+    return true;
+}
+
+
+bool CircuitEditor::solve() {
+    SparseMatrix &matrix = m_context.system.impedanceMatrix;
+    CircuitResults &results = m_context.results;
+    updateVoltages();
+    updateImpedances();
+    if (!m_solved || m_context.dirtyColumn < matrix.dim) {
+        // Factorize again the columns that changed
+        LUrefactor(matrix, m_context.factorization, m_context.dirtyColumn, m_workspace);
+        m_context.dirtyColumn = matrix.dim;
+        if (m_context.factorization.singular && matrix.dim > 0) {
+            m_solved = false;
+            m_error = "The impedance matrix of the circuit is singular";
+            return false;
+        }
+    }
+    // The currents are always solved from the whole voltages, not updated with the
+    // changes, so the rounding errors of a long sequence of edits don't add up.
+    // They are solved into the array of the previous currents, which is exchanged
+    // with the one of the results, so repeated solves don't allocate
+    solveLU(m_context.factorization, m_context.system.voltages, m_currents);
+    m_solved = true;
+
+    // Assign the currents to each mesh and branch
+    if (m_context.deferResults) {
+        results.meshCurrents.swap(m_currents);
+        results.branchCurrents.clear();
+        results.elementPowers.clear();
+    } else {
+        setCurrents(m_context.view(), m_currents, results);
+    }
+    return true;
+}
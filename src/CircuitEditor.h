@@ -0,0 +1,178 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitEditor.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the circuit editor, which changes a
+ * circuit that has already been solved and updates its equations system in place.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "CircuitSolver.h"
+
+
+/*!
+ * \brief An editor of a solved circuit.
+ *
+ * A class that adds, removes and changes the branches and elements of the circuit of
+ * a context. Each edit updates the meshes of the circuit, and only the elements of
+ * the impedance matrix and the voltages of the meshes that traverse the edited branch,
+ * instead of building the whole system again. The columns of the impedance matrix
+ * from the first mesh that changed are marked dirty, so solve() only factorizes those
+ * columns again. Edits that only change voltages don't factorize anything, and the
+ * currents are then solved with the factors of the previous solve. The edited elements
+ * of the impedance matrix and voltages are added up again from the elements of the
+ * circuit, never updated with the changes, and the currents are solved from all the
+ * voltages, so rounding errors don't build up over many edits.
+ *
+ * The circuit is always solved with mesh analysis. Adding or removing a branch edits
+ * the meshes like editing them in a circuit file declared by its meshes, so the nodes
+ * of the circuit are forgotten then.
+ */
+class CircuitEditor {
+
+    private:
+        CircuitContext &m_context;                  // The context of the edited circuit
+        std::vector<std::vector<std::pair<uint32_t, int>>> m_branchMeshes; // The meshes that traverse each branch, with their sign
+        std::vector<uint32_t> m_changedMeshes;      // The meshes whose voltage changed since the last solve
+        std::vector<std::pair<uint32_t, uint32_t>> m_changedEntries; // The (row, column) elements of the impedance matrix that changed since the last solve
+        SolveWorkspace m_workspace;                 // The workspace of the refactorizations
+        std::vector<double> m_currents;             // The mesh currents of the previous solve, whose array is reused
+        bool m_solved = false;                      // true if the mesh currents of the context solve the system before the changes
+        std::string m_error = "";                   // The description of the last error
+
+        /*!
+        * \brief Function that marks the elements of the impedance matrix of the meshes that traverse a branch as changed.
+        */
+        void addBranchImpedance(uint32_t t_branch);
+
+        /*!
+        * \brief Function that adds up again the elements of the impedance matrix that changed.
+        */
+        void updateImpedances();
+
+        /*!
+        * \brief Function that marks the voltages of the meshes that traverse a branch as changed.
+        */
+        void addBranchVoltage(uint32_t t_branch);
+
+        /*!
+        * \brief Function that adds up again the voltages of the meshes that changed.
+        */
+        void updateVoltages();
+
+        /*!
+        * \brief Function that adds the value of an element to its branch in the system.
+        */
+        void addElementValue(uint32_t t_branch, ElementKind t_kind, double t_value);
+
+    public:
+        /*!
+        * \brief Constructor.
+        *
+        * A compiled circuit is copied into the model of the context first, since it
+        * can't be changed. The mesh system of the context is reused if it has one for
+        * the circuit, and built otherwise.
+        *
+        * \param t_context The context of the circuit to edit, which must outlive the editor
+        */
+        explicit CircuitEditor(CircuitContext &t_context);
+
+        /*!
+        * \brief Function that changes the value of an element.
+        *
+        * \param t_elementID The element ID
+        * \param t_value The new value (Ω or V)
+        *
+        * \return true if the element was changed, false otherwise (see getError)
+        */
+        bool setValue(std::string_view t_elementID, double t_value);
+
+        /*!
+        * \brief Function that changes the value of an element found beforehand.
+        *
+        * \param t_element The index of the element in the circuit of the context
+        * \param t_value The new value (Ω or V)
+        */
+        void setElementValue(uint32_t t_element, double t_value);
+
+        /*!
+        * \brief Function that adds an element at the end of a branch.
+        *
+        * \param t_branchID The branch ID
+        * \param t_elementID The ID of the new element, not used by any other element
+        * \param t_kind The kind of the element
+        * \param t_value The value of the element (Ω or V)
+        *
+        * \return true if the element was added, false otherwise (see getError)
+        */
+        bool addElement(std::string_view t_branchID, std::string_view t_elementID, ElementKind t_kind,
+            double t_value);
+
+        /*!
+        * \brief Function that removes an element.
+        *
+        * \param t_elementID The element ID
+        *
+        * \return true if the element was removed, false otherwise (see getError)
+        */
+        bool removeElement(std::string_view t_elementID);
+
+        /*!
+        * \brief Function that adds a branch without elements.
+        *
+        * \param t_branchID The ID of the new branch, not used by any other branch
+        * \param t_meshes The ID of each mesh that traverses the branch, with +1 if it
+        * traverses it in its direction and -1 otherwise
+        *
+        * \return true if the branch was added, false otherwise (see getError)
+        */
+        bool addBranch(std::string_view t_branchID, const std::vector<std::pair<std::string, int>> &t_meshes);
+
+        /*!
+        * \brief Function that removes a branch, with its elements.
+        *
+        * \param t_branchID The branch ID
+        *
+        * \return true if the branch was removed, false otherwise (see getError)
+        */
+        bool removeBranch(std::string_view t_branchID);
+
+        /*!
+        * \brief Function that solves the edited circuit and fills the results of the context.
+        *
+        * \return true if the circuit was solved, false if its impedance matrix is singular
+        */
+        bool solve();
+
+        /*!
+        * \brief Function that returns the description of the last error.
+        *
+        * \return The error description
+        */
+        const std::string &getError() const {
+            return m_error;
+        }
+
+};
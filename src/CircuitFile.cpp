@@ -0,0 +1,232 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitFile.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to compile a
+ * circuit into a binary file and to load it back without parsing.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include "CircuitFile.h"
+#include "FileSections.h"
+
+using namespace std;
+
+namespace {
+
+    /*!
+    * \brief Function that returns the number of entries of the branch nodes section.
+    */
+    uint64_t branchNodesSize(const CircuitFileHeader &header) {
+        return header.nodeCount == 0 ? 0 : 2ull * header.branchCount;
+    }
+
+    /*!
+    * \brief Function that checks that the offsets of a CSR array go from 0 to its size without decreasing.
+    */
+    bool checkOffsets(const uint32_t *offsets, uint32_t count, uint64_t size) {
+        if (offsets[0] != 0 || offsets[count] != size)
+            return false;
+        for (uint32_t i = 0; i < count; i++) {
+            if (offsets[i] > offsets[i + 1])
+                return false;
+        }
+        return true;
+    }
+
+    /*!
+    * \brief Function that checks that every index of an array is below a limit.
+    */
+    bool checkIndices(const uint32_t *indices, uint64_t count, uint32_t limit) {
+        for (uint64_t i = 0; i < count; i++) {
+            if (indices[i] >= limit)
+                return false;
+        }
+        return true;
+    }
+
+    /*!
+    * \brief Function that checks that every offset, index, sign and kind of a mapped
+    * circuit is in range, so solving it never reads outside its arrays.
+    */
+    bool checkCircuit(const CircuitView &view, const CircuitFileHeader &header) {
+        if (!checkOffsets(view.stringOffsets, view.stringCount, header.stringDataSize) ||
+            !checkOffsets(view.meshBranchOffsets, view.meshCount, header.incidenceCount) ||
+            !checkOffsets(view.branchElementOffsets, view.branchCount, header.elementCount) ||
+            !checkIndices(view.meshIDs, view.meshCount, view.stringCount) ||
+            !checkIndices(view.branchIDs, view.branchCount, view.stringCount) ||
+            !checkIndices(view.elementIDs, view.elementCount, view.stringCount) ||
+            !checkIndices(view.meshBranchIndices, header.incidenceCount, view.branchCount) ||
+            !checkIndices(view.nodeIDs, view.nodeCount, view.stringCount) ||
+            !checkIndices(view.branchNodes, view.nodeCount == 0 ? 0 : 2ull * view.branchCount, view.nodeCount))
+            return false;
+        for (uint32_t k = 0; k < header.incidenceCount; k++) {
+            if (view.meshBranchSigns[k] != 1 && view.meshBranchSigns[k] != -1)
+                return false;
+        }
+        for (uint32_t e = 0; e < view.elementCount; e++) {
+            if ((view.elementKinds[e] != ElementKind::Resistance && view.elementKinds[e] != ElementKind::Battery) ||
+                !isfinite(view.elementValues[e]))
+                return false;
+        }
+        return true;
+    }
+
+}
+
+
+bool compileCircuit(const CircuitView &circuit, const string &fileName) {
+
+    CircuitFileHeader header = {};
+    memcpy(header.magic, CIRCUIT_FILE_MAGIC, sizeof(header.magic));
+    header.version = CIRCUIT_FILE_VERSION;
+    header.byteOrder = CIRCUIT_FILE_BYTE_ORDER;
+    header.stringCount = circuit.stringCount;
+    header.meshCount = circuit.meshCount;
+    header.branchCount = circuit.branchCount;
+    header.elementCount = circuit.elementCount;
+    header.incidenceCount = circuit.incidenceCount();
+    header.nodeCount = circuit.nodeCount;
+    header.stringDataSize = circuit.stringOffsets[circuit.stringCount];
+
+    ofstream file(fileName, ios::binary | ios::trunc);
+    if (!file)
+        return false;
+
+    // Write a placeholder header, then the sections, then the final header
+    writeSection(file, &header, sizeof(header));
+    header.sectionOffsets[SECTION_STRING_OFFSETS] =
+        writeSection(file, circuit.stringOffsets, (header.stringCount + 1ull) * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_STRING_DATA] =
+        writeSection(file, circuit.stringData, header.stringDataSize);
+    header.sectionOffsets[SECTION_MESH_IDS] =
+        writeSection(file, circuit.meshIDs, header.meshCount * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_MESH_BRANCH_OFFSETS] =
+        writeSection(file, circuit.meshBranchOffsets, (header.meshCount + 1ull) * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_MESH_BRANCH_INDICES] =
+        writeSection(file, circuit.meshBranchIndices, header.incidenceCount * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_MESH_BRANCH_SIGNS] =
+        writeSection(file, circuit.meshBranchSigns, header.incidenceCount * sizeof(int8_t));
+    header.sectionOffsets[SECTION_BRANCH_IDS] =
+        writeSection(file, circuit.branchIDs, header.branchCount * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_BRANCH_ELEMENT_OFFSETS] =
+        writeSection(file, circuit.branchElementOffsets, (header.branchCount + 1ull) * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_ELEMENT_IDS] =
+        writeSection(file, circuit.elementIDs, header.elementCount * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_ELEMENT_KINDS] =
+        writeSection(file, circuit.elementKinds, header.elementCount * sizeof(ElementKind));
+    header.sectionOffsets[SECTION_ELEMENT_VALUES] =
+        writeSection(file, circuit.elementValues, header.elementCount * sizeof(double));
+    header.sectionOffsets[SECTION_NODE_IDS] =
+        writeSection(file, circuit.nodeIDs, header.nodeCount * sizeof(uint32_t));
+    header.sectionOffsets[SECTION_BRANCH_NODES] =
+        writeSection(file, circuit.branchNodes, branchNodesSize(header) * sizeof(uint32_t));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    file.close();
+    return !file.fail();
+}
+
+
+bool MappedCircuit::open(const string &fileName) {
+    m_view = CircuitView();
+    if (!m_file.open(fileName)) {
+        m_error = m_file.getError();
+        return false;
+    }
+
+    // Check the header
+    const char *data = m_file.data();
+    size_t size = m_file.size();
+    if (size < sizeof(CircuitFileHeader)) {
+        m_error = fileName + " is not a compiled circuit file";
+        return false;
+    }
+    const CircuitFileHeader &header = *reinterpret_cast<const CircuitFileHeader *>(data);
+    if (memcmp(header.magic, CIRCUIT_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        m_error = fileName + " is not a compiled circuit file";
+        return false;
+    }
+    if (header.version != CIRCUIT_FILE_VERSION) {
+        m_error = fileName + " was compiled with an unsupported version (" +
+            to_string(header.version) + "), please compile it again";
+        return false;
+    }
+    if (header.byteOrder != CIRCUIT_FILE_BYTE_ORDER) {
+        m_error = fileName + " was compiled on a machine with a different byte order";
+        return false;
+    }
+
+    // Check that every section fits in the file
+    bool valid =
+        checkSection(header, SECTION_STRING_OFFSETS, (header.stringCount + 1ull) * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_STRING_DATA, header.stringDataSize, size) &&
+        checkSection(header, SECTION_MESH_IDS, header.meshCount * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_MESH_BRANCH_OFFSETS, (header.meshCount + 1ull) * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_MESH_BRANCH_INDICES, header.incidenceCount * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_MESH_BRANCH_SIGNS, header.incidenceCount * sizeof(int8_t), size) &&
+        checkSection(header, SECTION_BRANCH_IDS, header.branchCount * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_BRANCH_ELEMENT_OFFSETS, (header.branchCount + 1ull) * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_ELEMENT_IDS, header.elementCount * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_ELEMENT_KINDS, header.elementCount * sizeof(ElementKind), size) &&
+        checkSection(header, SECTION_ELEMENT_VALUES, header.elementCount * sizeof(double), size) &&
+        checkSection(header, SECTION_NODE_IDS, header.nodeCount * sizeof(uint32_t), size) &&
+        checkSection(header, SECTION_BRANCH_NODES, branchNodesSize(header) * sizeof(uint32_t), size);
+    if (!valid) {
+        m_error = fileName + " is truncated or corrupted";
+        return false;
+    }
+
+    // Point the view to the sections
+    const uint64_t *offsets = header.sectionOffsets;
+    CircuitView view;
+    view.stringCount = header.stringCount;
+    view.stringOffsets = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_STRING_OFFSETS]);
+    view.stringData = data + offsets[SECTION_STRING_DATA];
+    view.meshCount = header.meshCount;
+    view.meshIDs = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_MESH_IDS]);
+    view.meshBranchOffsets = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_MESH_BRANCH_OFFSETS]);
+    view.meshBranchIndices = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_MESH_BRANCH_INDICES]);
+    view.meshBranchSigns = reinterpret_cast<const int8_t *>(data + offsets[SECTION_MESH_BRANCH_SIGNS]);
+    view.branchCount = header.branchCount;
+    view.branchIDs = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_BRANCH_IDS]);
+    view.branchElementOffsets = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_BRANCH_ELEMENT_OFFSETS]);
+    view.elementCount = header.elementCount;
+    view.elementIDs = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_ELEMENT_IDS]);
+    view.elementKinds = reinterpret_cast<const ElementKind *>(data + offsets[SECTION_ELEMENT_KINDS]);
+    view.elementValues = reinterpret_cast<const double *>(data + offsets[SECTION_ELEMENT_VALUES]);
+    if (header.nodeCount > 0) {
+        view.nodeCount = header.nodeCount;
+        view.nodeIDs = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_NODE_IDS]);
+        view.branchNodes = reinterpret_cast<const uint32_t *>(data + offsets[SECTION_BRANCH_NODES]);
+    }
+
+    // Every offset and index must be in range, as the file may come from anywhere
+    if (!checkCircuit(view, header)) {
+        m_error = fileName + " is truncated or corrupted";
+        return false;
+    }
+
+    m_view = view;
+    return true;
+}
@@ -0,0 +1,137 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitFile.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to compile a
+ * circuit into a binary file and to load it back without parsing.
+ *
+ * A compiled circuit file starts with a CircuitFileHeader followed by the arrays
+ * of a CircuitView, each one aligned to 8 bytes. The arrays are written in the
+ * native byte order, so a compiled file can only be loaded on a machine with the
+ * same endianness as the one that compiled it.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include "CircuitView.h"
+#include "MappedFile.h"
+
+const char CIRCUIT_FILE_MAGIC[4] = {'C', 'S', 'B', 'C'};   // The first bytes of a compiled circuit
+const uint32_t CIRCUIT_FILE_VERSION = 2;                    // The version of the compiled circuit format
+const uint32_t CIRCUIT_FILE_BYTE_ORDER = 0x01020304;        // Written natively to detect the endianness
+
+/*!
+ * \brief The sections of a compiled circuit file.
+ *
+ * Each section stores one of the arrays of a CircuitView.
+ */
+enum CircuitFileSection {
+    SECTION_STRING_OFFSETS = 0,
+    SECTION_STRING_DATA,
+    SECTION_MESH_IDS,
+    SECTION_MESH_BRANCH_OFFSETS,
+    SECTION_MESH_BRANCH_INDICES,
+    SECTION_MESH_BRANCH_SIGNS,
+    SECTION_BRANCH_IDS,
+    SECTION_BRANCH_ELEMENT_OFFSETS,
+    SECTION_ELEMENT_IDS,
+    SECTION_ELEMENT_KINDS,
+    SECTION_ELEMENT_VALUES,
+    SECTION_NODE_IDS,
+    SECTION_BRANCH_NODES,
+    SECTION_COUNT
+};
+
+/*!
+ * \brief The header of a compiled circuit file.
+ */
+struct CircuitFileHeader {
+    char magic[4];                          // CIRCUIT_FILE_MAGIC
+    uint32_t version;                       // CIRCUIT_FILE_VERSION
+    uint32_t byteOrder;                     // CIRCUIT_FILE_BYTE_ORDER
+    uint32_t stringCount;                   // The number of interned strings
+    uint32_t meshCount;                     // The number of meshes
+    uint32_t branchCount;                   // The number of branches
+    uint32_t elementCount;                  // The number of elements
+    uint32_t incidenceCount;                // The number of mesh-branch incidence entries
+    uint32_t nodeCount;                     // The number of nodes, 0 if they are not known
+    uint32_t reserved;                      // Zero, keeps the next fields aligned
+    uint64_t stringDataSize;                // The size of the string characters (bytes)
+    uint64_t sectionOffsets[SECTION_COUNT]; // The position of each section in the file (bytes)
+};
+
+/*!
+* \brief Function that compiles a circuit into a binary file.
+*
+* \param t_circuit The packed circuit
+* \param t_fileName The name of the compiled circuit file
+*
+* \return true if the file was written, false otherwise
+*/
+bool compileCircuit(const CircuitView &t_circuit, const std::string &t_fileName);
+
+
+/*!
+ * \brief A compiled circuit loaded from a file.
+ *
+ * A class that maps a compiled circuit file into memory and exposes it as a CircuitView.
+ * The arrays of the view point straight into the mapping, so loading a circuit neither
+ * parses nor allocates anything per element. The header, the sizes of the sections
+ * and every offset, index, sign and kind stored in them are checked once when the
+ * file is opened, so a corrupted or hostile file is refused instead of being read
+ * out of bounds.
+ */
+class MappedCircuit {
+
+    private:
+        MappedFile m_file;          // The mapped compiled circuit file
+        CircuitView m_view;         // The view of the arrays stored in the file
+        std::string m_error = "";   // The description of the last error
+
+    public:
+        /*!
+        * \brief Function that loads a compiled circuit file.
+        *
+        * \param t_fileName The name of the compiled circuit file
+        *
+        * \return true if the circuit was loaded, false otherwise (see getError)
+        */
+        bool open(const std::string &t_fileName);
+
+        /*!
+        * \brief Function that returns the loaded circuit.
+        *
+        * \return The view of the circuit
+        */
+        const CircuitView &view() const {
+            return m_view;
+        }
+
+        /*!
+        * \brief Function that returns the description of the last error.
+        *
+        * \return The error description
+        */
+        const std::string &getError() const {
+            return m_error;
+        }
+
+};
@@ -0,0 +1,385 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitModel.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the circuit model.
+ */
+
+#include <cstring>
+#include "CircuitModel.h"
+
+using namespace std;
+
+namespace {
+
+    /*!
+    * \brief Function that empties a container and drops its storage.
+    */
+    template <typename Container>
+    void releaseContainer(Container &container) {
+        Container(container.get_allocator()).swap(container);
+    }
+
+}
+
+
+CircuitModel::CircuitModel() :
+    m_arena(MODEL_ARENA_INITIAL_SIZE),
+    m_stringOffsets(&m_arena), m_stringData(&m_arena), m_stringIndices(&m_arena),
+    m_meshIDs(&m_arena), m_meshBranchOffsets(&m_arena), m_meshBranchIndices(&m_arena), m_meshBranchSigns(&m_arena),
+    m_branchIDs(&m_arena), m_branchElementOffsets(&m_arena),
+    m_elementIDs(&m_arena), m_elementBranches(&m_arena), m_elementKinds(&m_arena), m_elementValues(&m_arena),
+    m_nodeIDs(&m_arena), m_branchNodes(&m_arena),
+    m_stringMeshes(&m_arena), m_stringBranches(&m_arena), m_stringElements(&m_arena), m_stringNodes(&m_arena) {
+
+    m_stringOffsets.push_back(0);
+    m_meshBranchOffsets.push_back(0);
+}
+
+
+CircuitModel::CircuitModel(const CircuitModel &model) :
+    m_arena(MODEL_ARENA_INITIAL_SIZE),
+    m_stringOffsets(model.m_stringOffsets, &m_arena), m_stringData(model.m_stringData, &m_arena),
+    m_stringIndices(&m_arena),
+    m_meshIDs(model.m_meshIDs, &m_arena), m_meshBranchOffsets(model.m_meshBranchOffsets, &m_arena),
+    m_meshBranchIndices(model.m_meshBranchIndices, &m_arena), m_meshBranchSigns(model.m_meshBranchSigns, &m_arena),
+    m_branchIDs(model.m_branchIDs, &m_arena), m_branchElementOffsets(model.m_branchElementOffsets, &m_arena),
+    m_elementIDs(model.m_elementIDs, &m_arena), m_elementBranches(model.m_elementBranches, &m_arena),
+    m_elementKinds(model.m_elementKinds, &m_arena), m_elementValues(model.m_elementValues, &m_arena),
+    m_nodeIDs(model.m_nodeIDs, &m_arena), m_branchNodes(model.m_branchNodes, &m_arena),
+    m_stringMeshes(model.m_stringMeshes, &m_arena), m_stringBranches(model.m_stringBranches, &m_arena),
+    m_stringElements(model.m_stringElements, &m_arena), m_stringNodes(model.m_stringNodes, &m_arena),
+    m_finalized(model.m_finalized) {
+
+    // The keys of the string index point to the arena of the other model
+    m_stringIndices.reserve(model.m_stringIndices.size());
+    for (auto &entry : model.m_stringIndices) {
+        char *key = static_cast<char *>(m_arena.allocate(entry.first.size(), 1));
+        memcpy(key, entry.first.data(), entry.first.size());
+        m_stringIndices.emplace(string_view(key, entry.first.size()), entry.second);
+    }
+}
+
+
+void CircuitModel::clear() {
+    // Drop the storage of every array, then give all the memory back at once
+    releaseContainer(m_stringOffsets);
+    releaseContainer(m_stringData);
+    releaseContainer(m_stringIndices);
+    releaseContainer(m_meshIDs);
+    releaseContainer(m_meshBranchOffsets);
+    releaseContainer(m_meshBranchIndices);
+    releaseContainer(m_meshBranchSigns);
+    releaseContainer(m_branchIDs);
+    releaseContainer(m_branchElementOffsets);
+    releaseContainer(m_elementIDs);
+    releaseContainer(m_elementBranches);
+    releaseContainer(m_elementKinds);
+    releaseContainer(m_elementValues);
+    releaseContainer(m_nodeIDs);
+    releaseContainer(m_branchNodes);
+    releaseContainer(m_stringMeshes);
+    releaseContainer(m_stringBranches);
+    releaseContainer(m_stringElements);
+    releaseContainer(m_stringNodes);
+    m_arena.release();
+
+    m_stringOffsets.push_back(0);
+    m_meshBranchOffsets.push_back(0);
+    m_finalized = true;
+}
+
+
+uint32_t CircuitModel::intern(string_view text) {
+    auto found = m_stringIndices.find(text);
+    if (found != m_stringIndices.end())
+        return found->second;
+
+    // The key of the index is a copy of the string in the arena, which does not
+    // move when m_stringData grows
+    uint32_t index = static_cast<uint32_t>(m_stringOffsets.size() - 1);
+    char *key = static_cast<char *>(m_arena.allocate(text.size(), 1));
+    memcpy(key, text.data(), text.size());
+    m_stringData.insert(m_stringData.end(), text.begin(), text.end());
+    m_stringOffsets.push_back(static_cast<uint32_t>(m_stringData.size()));
+    m_stringIndices.emplace(string_view(key, text.size()), index);
+    m_stringMeshes.push_back(NOT_FOUND);
+    m_stringBranches.push_back(NOT_FOUND);
+    m_stringElements.push_back(NOT_FOUND);
+    m_stringNodes.push_back(NOT_FOUND);
+    return index;
+}
+
+
+uint32_t CircuitModel::addBranch(string_view ID) {
+    uint32_t branch = branchCount();
+    uint32_t string_index = intern(ID);
+    // A finalized circuit keeps its element offsets up to date
+    bool offsets = m_branchElementOffsets.size() == m_branchIDs.size() + 1;
+    m_branchIDs.push_back(string_index);
+    if (offsets)
+        m_branchElementOffsets.push_back(m_branchElementOffsets.back());
+    m_stringBranches[string_index] = branch;
+    return branch;
+}
+
+
+uint32_t CircuitModel::addElement(uint32_t branch, string_view ID, ElementKind kind, double value) {
+    uint32_t element = elementCount();
+    uint32_t string_index = intern(ID);
+    m_elementIDs.push_back(string_index);
+    m_elementBranches.push_back(branch);
+    m_elementKinds.push_back(kind);
+    m_elementValues.push_back(value);
+    m_stringElements[string_index] = element;
+    m_finalized = false;
+    return element;
+}
+
+
+uint32_t CircuitModel::addMesh(string_view ID) {
+    uint32_t mesh = meshCount();
+    uint32_t string_index = intern(ID);
+    m_meshIDs.push_back(string_index);
+    m_meshBranchOffsets.push_back(m_meshBranchOffsets.back());
+    m_stringMeshes[string_index] = mesh;
+    return mesh;
+}
+
+
+void CircuitModel::addMeshBranch(uint32_t branch, int sign) {
+    m_meshBranchIndices.push_back(branch);
+    m_meshBranchSigns.push_back(static_cast<int8_t>(sign));
+    m_meshBranchOffsets.back()++;
+}
+
+
+uint32_t CircuitModel::addNode(string_view ID) {
+    uint32_t node = nodeCount();
+    uint32_t string_index = intern(ID);
+    m_nodeIDs.push_back(string_index);
+    m_stringNodes[string_index] = node;
+    return node;
+}
+
+
+void CircuitModel::setBranchNodes(uint32_t branch, uint32_t from, uint32_t to) {
+    if (m_branchNodes.size() < 2 * static_cast<size_t>(branchCount()))
+        m_branchNodes.resize(2 * static_cast<size_t>(branchCount()), NOT_FOUND);
+    m_branchNodes[2 * static_cast<size_t>(branch)] = from;
+    m_branchNodes[2 * static_cast<size_t>(branch) + 1] = to;
+}
+
+
+void CircuitModel::finalize() {
+    if (m_finalized && m_branchElementOffsets.size() == m_branchIDs.size() + 1)
+        return;
+
+    // Count the elements of each branch
+    uint32_t branches = branchCount();
+    m_branchElementOffsets.assign(branches + 1, 0);
+    for (uint32_t branch : m_elementBranches)
+        m_branchElementOffsets[branch + 1]++;
+    for (uint32_t b = 0; b < branches; b++)
+        m_branchElementOffsets[b + 1] += m_branchElementOffsets[b];
+
+    // Move every element to the range of its branch. The sort is stable, so the
+    // elements of a branch keep the order in which they were added
+    bool sorted = true;
+    for (size_t e = 1; e < m_elementBranches.size(); e++) {
+        if (m_elementBranches[e] < m_elementBranches[e - 1])
+            sorted = false;
+    }
+    if (!sorted) {
+        pmr::vector<uint32_t> next(m_branchElementOffsets.begin(), m_branchElementOffsets.end() - 1, &m_arena);
+        pmr::vector<uint32_t> element_IDs(m_elementIDs.size(), &m_arena);
+        pmr::vector<uint32_t> element_branches(m_elementBranches.size(), &m_arena);
+        pmr::vector<ElementKind> element_kinds(m_elementKinds.size(), &m_arena);
+        pmr::vector<double> element_values(m_elementValues.size(), &m_arena);
+        for (size_t e = 0; e < m_elementIDs.size(); e++) {
+            uint32_t position = next[m_elementBranches[e]]++;
+            element_IDs[position] = m_elementIDs[e];
+            element_branches[position] = m_elementBranches[e];
+            element_kinds[position] = m_elementKinds[e];
+            element_values[position] = m_elementValues[e];
+            m_stringElements[m_elementIDs[e]] = position;
+        }
+        m_elementIDs.swap(element_IDs);
+        m_elementBranches.swap(element_branches);
+        m_elementKinds.swap(element_kinds);
+        m_elementValues.swap(element_values);
+    }
+    m_finalized = true;
+}
+
+
+void CircuitModel::copyFrom(const CircuitView &circuit) {
+    clear();
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        addBranch(circuit.string(circuit.branchIDs[b]));
+        for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++)
+            addElement(b, circuit.string(circuit.elementIDs[e]), circuit.elementKinds[e], circuit.elementValues[e]);
+    }
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        addMesh(circuit.string(circuit.meshIDs[i]));
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++)
+            addMeshBranch(circuit.meshBranchIndices[k], circuit.meshBranchSigns[k]);
+    }
+    for (uint32_t n = 0; n < circuit.nodeCount; n++)
+        addNode(circuit.string(circuit.nodeIDs[n]));
+    for (uint32_t b = 0; b < circuit.branchCount && circuit.nodeCount > 0; b++)
+        setBranchNodes(b, circuit.branchNodes[2 * b], circuit.branchNodes[2 * b + 1]);
+    finalize();
+}
+
+
+uint32_t CircuitModel::insertElement(uint32_t branch, string_view ID, ElementKind kind, double value) {
+    uint32_t element = m_branchElementOffsets[branch + 1];
+    uint32_t string_index = intern(ID);
+    m_elementIDs.insert(m_elementIDs.begin() + element, string_index);
+    m_elementBranches.insert(m_elementBranches.begin() + element, branch);
+    m_elementKinds.insert(m_elementKinds.begin() + element, kind);
+    m_elementValues.insert(m_elementValues.begin() + element, value);
+    for (uint32_t b = branch + 1; b < m_branchElementOffsets.size(); b++)
+        m_branchElementOffsets[b]++;
+    for (uint32_t e = element; e < elementCount(); e++)
+        m_stringElements[m_elementIDs[e]] = e;
+    return element;
+}
+
+
+void CircuitModel::removeElement(uint32_t element) {
+    uint32_t branch = m_elementBranches[element];
+    m_stringElements[m_elementIDs[element]] = NOT_FOUND;
+    m_elementIDs.erase(m_elementIDs.begin() + element);
+    m_elementBranches.erase(m_elementBranches.begin() + element);
+    m_elementKinds.erase(m_elementKinds.begin() + element);
+    m_elementValues.erase(m_elementValues.begin() + element);
+    for (uint32_t b = branch + 1; b < m_branchElementOffsets.size(); b++)
+        m_branchElementOffsets[b]--;
+    for (uint32_t e = element; e < elementCount(); e++)
+        m_stringElements[m_elementIDs[e]] = e;
+}
+
+
+void CircuitModel::insertMeshBranch(uint32_t mesh, uint32_t branch, int sign) {
+    uint32_t position = m_meshBranchOffsets[mesh + 1];
+    m_meshBranchIndices.insert(m_meshBranchIndices.begin() + position, branch);
+    m_meshBranchSigns.insert(m_meshBranchSigns.begin() + position, static_cast<int8_t>(sign));
+    for (uint32_t i = mesh + 1; i < m_meshBranchOffsets.size(); i++)
+        m_meshBranchOffsets[i]++;
+}
+
+
+void CircuitModel::removeBranch(uint32_t branch) {
+    // Remove its elements, which are the last ones of the branch
+    while (m_branchElementOffsets[branch + 1] > m_branchElementOffsets[branch])
+        removeElement(m_branchElementOffsets[branch + 1] - 1);
+
+    // Remove the references of the meshes, and renumber the later branches
+    uint32_t kept = 0;
+    uint32_t mesh_start = 0;
+    for (uint32_t i = 0; i < meshCount(); i++) {
+        uint32_t mesh_end = m_meshBranchOffsets[i + 1];
+        for (uint32_t k = mesh_start; k < mesh_end; k++) {
+            uint32_t b = m_meshBranchIndices[k];
+            if (b == branch)
+                continue;
+            m_meshBranchIndices[kept] = b > branch ? b - 1 : b;
+            m_meshBranchSigns[kept] = m_meshBranchSigns[k];
+            kept++;
+        }
+        mesh_start = mesh_end;
+        m_meshBranchOffsets[i + 1] = kept;
+    }
+    m_meshBranchIndices.resize(kept);
+    m_meshBranchSigns.resize(kept);
+
+    // Remove the branch itself
+    m_stringBranches[m_branchIDs[branch]] = NOT_FOUND;
+    m_branchIDs.erase(m_branchIDs.begin() + branch);
+    m_branchElementOffsets.erase(m_branchElementOffsets.begin() + branch + 1);
+    for (auto &b : m_elementBranches) {
+        if (b > branch)
+            b--;
+    }
+    for (uint32_t b = branch; b < branchCount(); b++)
+        m_stringBranches[m_branchIDs[b]] = b;
+    if (m_branchNodes.size() >= 2 * static_cast<size_t>(branch) + 2)
+        m_branchNodes.erase(m_branchNodes.begin() + 2 * branch, m_branchNodes.begin() + 2 * branch + 2);
+}
+
+
+void CircuitModel::clearNodes() {
+    for (uint32_t node_ID : m_nodeIDs)
+        m_stringNodes[node_ID] = NOT_FOUND;
+    m_nodeIDs.clear();
+    m_branchNodes.clear();
+}
+
+
+uint32_t CircuitModel::findMesh(string_view ID) const {
+    auto found = m_stringIndices.find(ID);
+    return found == m_stringIndices.end() ? NOT_FOUND : m_stringMeshes[found->second];
+}
+
+
+uint32_t CircuitModel::findBranch(string_view ID) const {
+    auto found = m_stringIndices.find(ID);
+    return found == m_stringIndices.end() ? NOT_FOUND : m_stringBranches[found->second];
+}
+
+
+uint32_t CircuitModel::findElement(string_view ID) const {
+    auto found = m_stringIndices.find(ID);
+    return found == m_stringIndices.end() ? NOT_FOUND : m_stringElements[found->second];
+}
+
+
+uint32_t CircuitModel::findNode(string_view ID) const {
+    auto found = m_stringIndices.find(ID);
+    return found == m_stringIndices.end() ? NOT_FOUND : m_stringNodes[found->second];
+}
+
+
+CircuitView CircuitModel::view() const {
+    CircuitView view;
+    view.stringCount = static_cast<uint32_t>(m_stringOffsets.size() - 1);
+    view.stringOffsets = m_stringOffsets.data();
+    view.stringData = m_stringData.data();
+    view.meshCount = meshCount();
+    view.meshIDs = m_meshIDs.data();
+    view.meshBranchOffsets = m_meshBranchOffsets.data();
+    view.meshBranchIndices = m_meshBranchIndices.data();
+    view.meshBranchSigns = m_meshBranchSigns.data();
+    view.branchCount = branchCount();
+    view.branchIDs = m_branchIDs.data();
+    view.branchElementOffsets = m_branchElementOffsets.data();
+    view.elementCount = elementCount();
+    view.elementIDs = m_elementIDs.data();
+    view.elementKinds = m_elementKinds.data();
+    view.elementValues = m_elementValues.data();
+    if (m_branchNodes.size() == 2 * static_cast<size_t>(branchCount())) {
+        view.nodeCount = nodeCount();
+        view.nodeIDs = m_nodeIDs.data();
+        view.branchNodes = m_branchNodes.data();
+    }
+    return view;
+}
@@ -0,0 +1,335 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitModel.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the circuit model, which stores the
+ * meshes, branches and elements of a circuit in parallel arrays.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "CircuitView.h"
+
+// Index returned by the find functions when the ID does not exist
+const uint32_t NOT_FOUND = UINT32_MAX;
+
+// Size of the first block of the arena of a model (bytes), enough for small circuits
+const size_t MODEL_ARENA_INITIAL_SIZE = 64 * 1024;
+
+
+/*!
+ * \brief An electric circuit.
+ *
+ * A class that owns the arrays described by a CircuitView. Meshes, branches and
+ * elements are identified by their position in the arrays, and their IDs are
+ * interned in a string table, so each ID is stored only once.
+ *
+ * The circuit is built by adding branches and their elements, and meshes and the
+ * branches they traverse. The elements of a branch may be added at any time;
+ * finalize() groups them by branch before the circuit is viewed.
+ *
+ * Every array of the model is allocated from a monotonic arena owned by the model.
+ * Memory is never returned to the heap while the circuit is built, and the whole
+ * circuit is released in one step when the model is destroyed or cleared.
+ */
+class CircuitModel {
+
+    private:
+        std::pmr::monotonic_buffer_resource m_arena;    // The arena every array is allocated from
+
+        // Interned identifiers
+        std::pmr::vector<uint32_t> m_stringOffsets;     // The offsets of the strings in m_stringData
+        std::pmr::vector<char> m_stringData;            // The characters of all the strings
+        std::pmr::unordered_map<std::string_view, uint32_t> m_stringIndices; // The index of each string, keyed by a copy in the arena
+
+        // Meshes
+        std::pmr::vector<uint32_t> m_meshIDs;           // The string index of each mesh ID
+        std::pmr::vector<uint32_t> m_meshBranchOffsets; // The offsets of the branches of each mesh
+        std::pmr::vector<uint32_t> m_meshBranchIndices; // The branch index of each incidence entry
+        std::pmr::vector<int8_t> m_meshBranchSigns;     // The orientation of each incidence entry
+
+        // Branches
+        std::pmr::vector<uint32_t> m_branchIDs;         // The string index of each branch ID
+        std::pmr::vector<uint32_t> m_branchElementOffsets; // The offsets of the elements of each branch
+
+        // Elements
+        std::pmr::vector<uint32_t> m_elementIDs;        // The string index of each element ID
+        std::pmr::vector<uint32_t> m_elementBranches;   // The branch of each element
+        std::pmr::vector<ElementKind> m_elementKinds;   // The kind of each element
+        std::pmr::vector<double> m_elementValues;       // The value of each element
+
+        // Nodes
+        std::pmr::vector<uint32_t> m_nodeIDs;           // The string index of each node ID
+        std::pmr::vector<uint32_t> m_branchNodes;       // The from and to nodes of each branch
+
+        // What each interned string identifies, indexed by string
+        std::pmr::vector<uint32_t> m_stringMeshes;      // The mesh with this ID, or NOT_FOUND
+        std::pmr::vector<uint32_t> m_stringBranches;    // The branch with this ID, or NOT_FOUND
+        std::pmr::vector<uint32_t> m_stringElements;    // The element with this ID, or NOT_FOUND
+        std::pmr::vector<uint32_t> m_stringNodes;       // The node with this ID, or NOT_FOUND
+
+        bool m_finalized = true;                        // false if elements were added after finalize()
+
+        /*!
+        * \brief Function that returns the index of a string, interning it if needed.
+        */
+        uint32_t intern(std::string_view t_text);
+
+    public:
+        /*!
+        * \brief Default constructor.
+        *
+        * Creates an empty circuit.
+        */
+        CircuitModel();
+
+        /*!
+        * \brief Copy constructor.
+        *
+        * Copies a circuit into a new arena.
+        */
+        CircuitModel(const CircuitModel &t_model);
+
+        CircuitModel &operator=(const CircuitModel &) = delete;
+
+        /*!
+        * \brief Function that removes the whole circuit and releases its memory at once.
+        */
+        void clear();
+
+        /*!
+        * \brief Function that adds a branch without elements.
+        *
+        * \param t_ID The branch ID
+        *
+        * \return The index of the new branch
+        */
+        uint32_t addBranch(std::string_view t_ID);
+
+        /*!
+        * \brief Function that adds an element to a branch.
+        *
+        * \param t_branch The index of the branch
+        * \param t_ID The element ID
+        * \param t_kind The kind of the element
+        * \param t_value The value of the element (Ω or V)
+        *
+        * \return The index of the new element, which may change when finalize() is called
+        */
+        uint32_t addElement(uint32_t t_branch, std::string_view t_ID, ElementKind t_kind, double t_value);
+
+        /*!
+        * \brief Function that adds a mesh without branches.
+        *
+        * \param t_ID The mesh ID
+        *
+        * \return The index of the new mesh
+        */
+        uint32_t addMesh(std::string_view t_ID);
+
+        /*!
+        * \brief Function that adds a branch to the last mesh added.
+        *
+        * \param t_branch The index of the branch
+        * \param t_sign +1 if the mesh traverses the branch in its direction, -1 otherwise
+        */
+        void addMeshBranch(uint32_t t_branch, int t_sign);
+
+        /*!
+        * \brief Function that adds a node.
+        *
+        * \param t_ID The node ID
+        *
+        * \return The index of the new node
+        */
+        uint32_t addNode(std::string_view t_ID);
+
+        /*!
+        * \brief Function that sets the nodes a branch connects.
+        *
+        * Either every branch of a circuit connects two nodes, or none does.
+        *
+        * \param t_branch The index of the branch
+        * \param t_from The node the branch current leaves
+        * \param t_to The node the branch current enters
+        */
+        void setBranchNodes(uint32_t t_branch, uint32_t t_from, uint32_t t_to);
+
+        /*!
+        * \brief Function that groups the elements by branch, keeping the order in
+        * which they were added to each branch.
+        */
+        void finalize();
+
+        /*!
+        * \brief Function that replaces the circuit by a copy of a packed circuit.
+        *
+        * \param t_circuit The packed circuit
+        */
+        void copyFrom(const CircuitView &t_circuit);
+
+        /*!
+        * \brief Function that changes the value of an element.
+        *
+        * \param t_element The index of the element
+        * \param t_value The new value (Ω or V)
+        */
+        void setElementValue(uint32_t t_element, double t_value) {
+            m_elementValues[t_element] = t_value;
+        }
+
+        /*!
+        * \brief Function that adds an element at the end of a branch of a finalized circuit.
+        *
+        * The elements of the later branches move one position.
+        *
+        * \param t_branch The index of the branch
+        * \param t_ID The element ID
+        * \param t_kind The kind of the element
+        * \param t_value The value of the element (Ω or V)
+        *
+        * \return The index of the new element
+        */
+        uint32_t insertElement(uint32_t t_branch, std::string_view t_ID, ElementKind t_kind, double t_value);
+
+        /*!
+        * \brief Function that removes an element of a finalized circuit.
+        *
+        * The later elements move one position.
+        *
+        * \param t_element The index of the element
+        */
+        void removeElement(uint32_t t_element);
+
+        /*!
+        * \brief Function that adds a branch to a mesh, after its other branches.
+        *
+        * \param t_mesh The index of the mesh
+        * \param t_branch The index of the branch
+        * \param t_sign +1 if the mesh traverses the branch in its direction, -1 otherwise
+        */
+        void insertMeshBranch(uint32_t t_mesh, uint32_t t_branch, int t_sign);
+
+        /*!
+        * \brief Function that removes a branch of a finalized circuit, with its elements
+        * and every reference of the meshes to it.
+        *
+        * The later branches move one position.
+        *
+        * \param t_branch The index of the branch
+        */
+        void removeBranch(uint32_t t_branch);
+
+        /*!
+        * \brief Function that forgets the nodes of the circuit, which is then only
+        * described by its meshes.
+        */
+        void clearNodes();
+
+        /*!
+        * \brief Function that returns the index of a mesh.
+        *
+        * \param t_ID The mesh ID
+        *
+        * \return The index of the mesh, or NOT_FOUND
+        */
+        uint32_t findMesh(std::string_view t_ID) const;
+
+        /*!
+        * \brief Function that returns the index of a branch.
+        *
+        * \param t_ID The branch ID
+        *
+        * \return The index of the branch, or NOT_FOUND
+        */
+        uint32_t findBranch(std::string_view t_ID) const;
+
+        /*!
+        * \brief Function that returns the index of an element.
+        *
+        * \param t_ID The element ID
+        *
+        * \return The index of the element, or NOT_FOUND
+        */
+        uint32_t findElement(std::string_view t_ID) const;
+
+        /*!
+        * \brief Function that returns the index of a node.
+        *
+        * \param t_ID The node ID
+        *
+        * \return The index of the node, or NOT_FOUND
+        */
+        uint32_t findNode(std::string_view t_ID) const;
+
+        /*!
+        * \brief Function that returns the branch an element belongs to.
+        *
+        * \param t_element The index of the element
+        *
+        * \return The index of the branch
+        */
+        uint32_t elementBranch(uint32_t t_element) const {
+            return m_elementBranches[t_element];
+        }
+
+        /*!
+        * \brief Function that returns the number of meshes.
+        */
+        uint32_t meshCount() const {
+            return static_cast<uint32_t>(m_meshIDs.size());
+        }
+
+        /*!
+        * \brief Function that returns the number of branches.
+        */
+        uint32_t branchCount() const {
+            return static_cast<uint32_t>(m_branchIDs.size());
+        }
+
+        /*!
+        * \brief Function that returns the number of elements.
+        */
+        uint32_t elementCount() const {
+            return static_cast<uint32_t>(m_elementIDs.size());
+        }
+
+        /*!
+        * \brief Function that returns the number of nodes.
+        */
+        uint32_t nodeCount() const {
+            return static_cast<uint32_t>(m_nodeIDs.size());
+        }
+
+        /*!
+        * \brief Function that returns the packed view of the circuit.
+        *
+        * The view points to the arrays of the model, so it is valid until the model is
+        * modified or destroyed. finalize() must be called before.
+        *
+        * \return The view of the circuit
+        */
+        CircuitView view() const;
+
+};
@@ -23,267 +23,1063 @@ limitations under the License.
  * to build and solve the circuit.
  */
 
+#include <algorithm>
+#include <chrono>
 #include "CircuitSolver.h"
+#include "CircuitFile.h"
+#include "ValueParser.h"
+#include "Parallel.h"
+#include "XmlArena.h"
+#include "Netlist.h"
+#include "NodalAnalysis.h"
+#include "ResultsWriter.h"
+#include "ResultsFile.h"
+#include "Log.h"
+#include "Batch.h"
+#include "SolverServer.h"
+#include "Sweep.h"
+#include "MonteCarlo.h"
+#include "Sensitivity.h"
 
 using namespace std;
 
-Mesh::Mesh(string t_ID, pugi::xml_node t_mesh) {
-    cout << "\nCreating mesh with ID: " << t_ID << endl;
-    // Assign the mesh ID
-    this->ID = t_ID;
-    // Read the elements in this mesh
-    this->readElements(t_mesh);
+// Minimum number of branches or meshes assembled by each thread
+const size_t ASSEMBLY_ITEMS_PER_THREAD = 4096;
+
+// Minimum number of branches whose powers are computed by each thread
+const size_t POWER_ITEMS_PER_THREAD = 65536;
+
+// Number of results formatted by each thread before the threads write them in order
+const size_t FORMAT_ITEMS_PER_THREAD = 16384;
+
+namespace {
+
+    /*!
+    * \brief Function that reads the batteries and resistances of a branch node.
+    * 
+    * Elements already in the branch are skipped, so a branch declared by several
+    * meshes keeps the elements and values of its first declaration.
+    */
+    void readElements(pugi::xml_node branch, uint32_t b, CircuitModel &model) {
+        // The IDs are viewed in place in the document, the model keeps its own copy
+        auto read = [&](pugi::xml_node element, ElementKind kind) {
+            string_view element_ID = element.attribute("ID").as_string();
+            uint32_t e = model.findElement(element_ID);
+            if (e == NOT_FOUND)
+                model.addElement(b, element_ID, kind, readValue(element));
+            else if (model.elementBranch(e) != b)
+                logMessage(LogLevel::Error, "ERROR: Element with ID: ", element_ID,
+                    " is defined in more than one branch");
+            return element_ID;
+        };
+
+        // Read the batteries in this branch
+        for (auto element : branch.children("battery")) {
+            string_view battery_ID = read(element, ElementKind::Battery);
+            logMessage(LogLevel::Trace, "--> Found battery with ID: ", battery_ID);
+        }
+
+        // Read the resistances in this branch
+        for (auto element : branch.children("resistance")) {
+            string_view impedance_ID = read(element, ElementKind::Resistance);
+            logMessage(LogLevel::Trace, "--> Found impedance with ID: ", impedance_ID);
+        }
+    }
+
+
+    /*!
+    * \brief Function that writes an ID as a JSON string.
+    */
+    void writeJsonString(ResultsWriter &writer, string_view text) {
+        static const char hex_digits[] = "0123456789abcdef";
+        writer.text("\"");
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                char escaped[2] = {'\\', c};
+                writer.text(string_view(escaped, 2));
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[6] = {'\\', 'u', '0', '0', hex_digits[(c >> 4) & 0xF], hex_digits[c & 0xF]};
+                writer.text(string_view(escaped, 6));
+            } else {
+                writer.text(string_view(&c, 1));
+            }
+        }
+        writer.text("\"");
+    }
+
+    /*!
+    * \brief Function that writes one record of the results.
+    */
+    void writeRecord(ResultsWriter &writer, RecordFormat format, string_view kind, string_view ID,
+        string_view quantity, double value) {
+        if (format == RecordFormat::Csv) {
+            writer.text(kind).text(",");
+            writer.csvField(ID);
+            writer.text(",").text(quantity).text(",").number(value).text("\n");
+        } else {
+            writer.text("{\"kind\":\"").text(kind).text("\",\"ID\":");
+            writeJsonString(writer, ID);
+            // JSON has no infinities nor NaNs
+            writer.text(",\"").text(quantity).text("\":");
+            if (isfinite(value))
+                writer.number(value);
+            else
+                writer.text("null");
+            writer.text("}\n");
+        }
+    }
+
+
+    /*!
+    * \brief Function that splits a comma separated list, skipping the empty items.
+    */
+    vector<string> splitList(const string &list) {
+        vector<string> items;
+        size_t start = 0;
+        while (start <= list.length()) {
+            size_t comma = list.find(',', start);
+            if (comma == string::npos)
+                comma = list.length();
+            if (comma > start)
+                items.push_back(list.substr(start, comma - start));
+            start = comma + 1;
+        }
+        return items;
+    }
+
+
+    /*!
+    * \brief Function that formats a list of items in parallel chunks.
+    *
+    * The items are split in rounds of FORMAT_ITEMS_PER_THREAD items per thread. In each
+    * round, every thread formats a contiguous range of items into its own writer, and
+    * then the text of the threads is written in order, so the output is the same as if
+    * the items were formatted one after another. format(writer, i) must only read shared
+    * data.
+    */
+    template <typename Format>
+    void formatItems(ResultsWriter &writer, size_t count, bool parallel, const Format &format) {
+        unsigned threads = parallel ? threadCount(count, FORMAT_ITEMS_PER_THREAD) : 1;
+        if (threads == 1) {
+            for (size_t i = 0; i < count; i++)
+                format(writer, i);
+            return;
+        }
+
+        vector<ResultsWriter> chunks(threads);
+        size_t round_size = threads * FORMAT_ITEMS_PER_THREAD;
+        for (size_t round_start = 0; round_start < count; round_start += round_size) {
+            size_t round_count = min(round_size, count - round_start);
+            parallelFor(round_count, threads, [&](size_t begin, size_t end, unsigned t) {
+                chunks[t].clear();
+                for (size_t i = begin; i < end; i++)
+                    format(chunks[t], round_start + i);
+            });
+            for (unsigned t = 0; t < threads; t++)
+                writer.text(chunks[t].buffered());
+        }
+    }
+
+
+    bool interactive = true;        // false if the program must never wait for the user
+
+
+    /*!
+    * \brief Function that waits for the user, once every message is on the console.
+    */
+    void pauseConsole() {
+        flushLog();
+        if (interactive)
+            system("pause");
+    }
+
 }
 
 
-Mesh::~Mesh() {}
+double readValue(pugi::xml_node element) {
+    double value = 0.0;
+    // Decode the value attribute only once, with engineering suffixes allowed
+    if (!parseValue(element.attribute("value").value(), value)) {
+        logMessage(LogLevel::Error, "ERROR: Invalid value \"", element.attribute("value").value(),
+            "\" for element with ID: ", element.attribute("ID").as_string(), ", it will be taken as 0");
+    }
+    return value;
+}
+
+
+int readSign(pugi::xml_node reference) {
+    string_view sign = reference.attribute("sign").as_string("+");
+    if (sign == "+" || sign == "+1" || sign == "1")
+        return 1;
+    if (sign == "-" || sign == "-1")
+        return -1;
+    logMessage(LogLevel::Error, "ERROR: Invalid sign \"", sign, "\" for branch with ID: ",
+        reference.attribute("ID").as_string(), ", it will be taken as +");
+    return 1;
+}
+
+
+void readBranches(pugi::xml_node branches_node, CircuitModel &model) {
+    // Read the branches defined in this section
+    for (auto branch : branches_node.children("branch")) {
+        string_view branch_ID = branch.attribute("ID").as_string();
+
+        // Each branch can only be defined once
+        if (model.findBranch(branch_ID) != NOT_FOUND) {
+            logMessage(LogLevel::Error, "ERROR: Branch with ID: ", branch_ID, " is defined more than once");
+            continue;
+        }
+        logMessage(LogLevel::Verbose, "\nCreating branch with ID: ", branch_ID);
+        readElements(branch, model.addBranch(branch_ID), model);
+    }
+}
+
 
+void readMesh(pugi::xml_node t_mesh, CircuitModel &model) {
+    string_view mesh_ID = t_mesh.attribute("ID").as_string();
+    logMessage(LogLevel::Verbose, "\nCreating mesh with ID: ", mesh_ID);
+    model.addMesh(mesh_ID);
 
-void Mesh::readElements(pugi::xml_node t_mesh) {
-    // Create an iterator of branches
-    vector<Branch>::iterator br;
+    // If the circuit defines its branches in a <branches> section, the mesh
+    // only references them
+    bool references = !t_mesh.parent().child("branches").empty();
 
     // Read the branches in this mesh
     for (auto branch : t_mesh.children("branch")) {
-        if (branchesVector.size() == 0) {
-            // Always push this branch if the branchesVector is empty
-            branchesVector.emplace_back(Branch{branch.attribute("ID").as_string()});
-        } else {
-            // Look for this branch in the branchesVector
-            bool ID_found = false;
-            for (br = branchesVector.begin(); br != branchesVector.end(); br++) {
-                if (br->ID == branch.attribute("ID").as_string())
-                    ID_found = true;
-            }
-            // If this branch is not in the branchesVector yet, then push it
-            if (!ID_found) {
-                branchesVector.emplace_back(Branch{branch.attribute("ID").as_string()});
+        string_view branch_ID = branch.attribute("ID").as_string();
+        uint32_t b = model.findBranch(branch_ID);
+
+        if (references) {
+            // The referenced branch must have been defined
+            if (b == NOT_FOUND) {
+                logMessage(LogLevel::Error, "ERROR: Branch with ID: ", branch_ID, " is not defined");
+                continue;
             }
+            // Attach the branch to the mesh with the orientation given by the reference
+            int sign = readSign(branch);
+            model.addMeshBranch(b, sign);
+            logMessage(LogLevel::Trace, "--> Found branch with ID: ", branch_ID, sign > 0 ? " (+)" : " (-)");
+            continue;
         }
-        // The branch ID is always attached to the the mesh
-        this->m_branchesIDs.push_back(branch.attribute("ID").as_string());
 
-        // Read the batteries in this branch
-        for (auto element : branch.children("battery")) {
-            // Update the mesh voltage
-            this->m_powerSource += element.attribute("value").as_double();
-            cout << "--> Found battery with ID: " << element.attribute("ID").as_string() << endl;
+        // If this branch is not in the model yet, then add it. The first mesh that
+        // declares a branch defines its orientation, the other meshes traverse it
+        // in the opposite direction
+        if (b == NOT_FOUND) {
+            b = model.addBranch(branch_ID);
+            model.addMeshBranch(b, 1);
+        } else {
+            model.addMeshBranch(b, -1);
         }
+        readElements(branch, b, model);
+    }
+}
 
-        // Read the resistances in this branch
-        for (auto element : branch.children("resistance")) {
-            // Look for this branch in the branchesVector
-            for (br = branchesVector.begin(); br != branchesVector.end(); br++) {
-                if (br->ID == branch.attribute("ID").as_string()) {
-                    if (br->impedanceIDs.size() == 0) {
-                        // Always push this impedance if the impedanceIDs vector is empty
-                        br->impedanceIDs.push_back(element.attribute("ID").as_string());
-                        // Update the branch impedance
-                        br->branchImpedance += element.attribute("value").as_double();
-                        br->impedances.push_back(element.attribute("value").as_double());
-                    } else {
-                        // Look for this impedance in the impedanceIDs vector
-                        for (size_t i = 0; i < br->impedanceIDs.size(); i++) {
-                            if (br->impedanceIDs[i] != element.attribute("ID").as_string()) {
-                                // Push this impedance to the branch
-                                br->impedanceIDs.push_back(element.attribute("ID").as_string());
-                                // Update the branch impedance
-                                br->branchImpedance += element.attribute("value").as_double();
-                                br->impedances.push_back(element.attribute("value").as_double());
-                            }
-                        }
-                    }
-                    // Update the mesh impedance
-                    this->m_impedance += element.attribute("value").as_double();
-                    cout << "--> Found impedance with ID: " << element.attribute("ID").as_string() << endl;
-                }
-            }
+
+void readNetlist(pugi::xml_node netlist, CircuitModel &model) {
+    // The index of a node, which is added the first time it is found
+    auto readNode = [&](pugi::xml_node item, const char *attribute) {
+        string_view node_ID = item.attribute(attribute).as_string();
+        uint32_t node = model.findNode(node_ID);
+        return node == NOT_FOUND ? model.addNode(node_ID) : node;
+    };
+
+    // Read the branches and the nodes they connect. Each element out of a <branch>
+    // is a branch on its own, with the ID of the element
+    vector<NetlistEdge> edges;
+    vector<uint32_t> edge_branches;
+    for (auto item : netlist.children()) {
+        string_view item_name = item.name();
+        string_view item_ID = item.attribute("ID").as_string();
+        bool element = item_name == "battery" || item_name == "resistance";
+        if (item_name != "branch" && !element) {
+            logMessage(LogLevel::Error, "ERROR: Unknown netlist item <", item_name, ">, it will be ignored");
+            continue;
+        }
+        if (!item.attribute("from") || !item.attribute("to")) {
+            logMessage(LogLevel::Error, "ERROR: Branch with ID: ", item_ID,
+                " must have the from and to nodes, it will be ignored");
+            continue;
         }
+        if (model.findBranch(item_ID) != NOT_FOUND) {
+            logMessage(LogLevel::Error, "ERROR: Branch with ID: ", item_ID, " is defined more than once");
+            continue;
+        }
+
+        logMessage(LogLevel::Verbose, "\nCreating branch with ID: ", item_ID);
+        uint32_t b = model.addBranch(item_ID);
+        if (element) {
+            ElementKind kind = item_name == "battery" ? ElementKind::Battery : ElementKind::Resistance;
+            model.addElement(b, item_ID, kind, readValue(item));
+            logMessage(LogLevel::Trace, kind == ElementKind::Battery ? "--> Found battery with ID: " :
+                "--> Found impedance with ID: ", item_ID);
+        } else {
+            readElements(item, b, model);
+        }
+        uint32_t from = readNode(item, "from");
+        uint32_t to = readNode(item, "to");
+        model.setBranchNodes(b, from, to);
+        edges.push_back(NetlistEdge{from, to});
+        edge_branches.push_back(b);
+    }
+
+    // Find the independent loops, which are the meshes of the circuit
+    LoopBasis loops = findLoops(model.nodeCount(), edges);
+    for (size_t l = 0; l + 1 < loops.offsets.size(); l++) {
+        model.addMesh("loop-" + to_string(l + 1));
+        for (uint32_t k = loops.offsets[l]; k < loops.offsets[l + 1]; k++)
+            model.addMeshBranch(edge_branches[loops.edges[k]], loops.signs[k]);
+    }
+    logMessage(LogLevel::Info, "\nFound ", loops.offsets.size() - 1, " independent loops among ",
+        model.nodeCount(), " nodes");
+}
+
+
+void readCircuit(pugi::xml_node circuit, CircuitModel &model) {
+    pugi::xml_node netlist = circuit.child("netlist");
+    if (netlist) {
+        // The circuit is given by the nodes its branches connect
+        readNetlist(netlist, model);
+    } else {
+        // Read the branches, if they are defined once for the whole circuit
+        readBranches(circuit.child("branches"), model);
+
+        // Read meshes
+        for (auto mesh_node : circuit.children("mesh"))
+            readMesh(mesh_node, model);
     }
+
+    // Group the elements by branch
+    model.finalize();
 }
 
 
-System createSystem(vector<Mesh> &mVector, vector<Branch> &bVector) {
+bool loadCircuit(const string &fileName, CircuitContext &context) {
+    string extension = fileName.length() > 3 ? fileName.substr(fileName.length() - 3) : "";
 
-    // Declare the impedance matrix and the voltages vector
-    vector<double> voltages(mVector.size());
-    vector<vector<double>> impedance_matrix(mVector.size());
+    // Check if it is a valid XML file
+    if (extension == "xml") {
+        logMessage(LogLevel::Info, "Reading circuit file: ", fileName);
+
+        // Read the input data file. The document is allocated from the XML arena of
+        // this thread, which is reset once the document is destroyed
+        bool loaded;
+        {
+            pugi::xml_document xml_file;
+            auto res = xml_file.load_file(fileName.c_str());
 
-    // Initialize values
-    for (int i = 0; i < mVector.size(); i ++) {
-        // Initialize impedance_matrix with zeros
-        impedance_matrix[i].resize(mVector.size());
-        for (int j = 0; j < mVector.size(); j ++) {
-            impedance_matrix[i][j] = 0.0;
+            // Check if it was loaded
+            loaded = res;
+            if (!loaded) {
+                logMessage(LogLevel::Error, "ERROR: There were problems loading ", fileName);
+                logMessage(LogLevel::Error, "ERROR: ", res.description());
+                logMessage(LogLevel::Error, "Error offset: ", res.offset);
+            } else {
+                readCircuit(xml_file.child("circuit"), context.model);
+                context.isCompiled = false;
+            }
         }
-        // Fill the voltages array
-        voltages[i] = mVector[i].getPowerSource();
+        resetXmlArena();
+        return loaded;
     }
 
-    // Build the impedance_matrix
-    // Fill the matrix diagonal with the total impedance of each mesh
-    for (int i = 0; i < mVector.size(); i ++) {
-        impedance_matrix[i][i] = mVector[i].getImpedance();
+    // Check if it is a compiled circuit file
+    if (extension == "csb") {
+        logMessage(LogLevel::Info, "Loading compiled circuit file: ", fileName);
+
+        // Map the compiled circuit, no parsing is required
+        if (!context.compiled.open(fileName)) {
+            logMessage(LogLevel::Error, "ERROR: There were problems loading ", fileName);
+            logMessage(LogLevel::Error, "ERROR: ", context.compiled.getError());
+            return false;
+        }
+        context.isCompiled = true;
+        return true;
     }
-    // Fill the rest of the element of the matrix
-    for (int i = 0; i < mVector.size(); i ++) {
-        // Complementaries indexes
-        vector<int> ind;
-        for (int n = 0; n < mVector.size(); n ++){
-            if (n != i)
-                ind.push_back(n);
+
+    logMessage(LogLevel::Error, "INVALID INPUT FILE, PLEASE PROVIDE AN XML INPUT FILE");
+    return false;
+}
+
+
+System createSystem(const CircuitView &circuit) {
+
+    // Calculate the impedance and the voltage of each branch, which are the
+    // diagonal matrix R and the vector E
+    vector<double> branch_impedances(circuit.branchCount, 0.0);
+    vector<double> branch_voltages(circuit.branchCount, 0.0);
+    parallelFor(circuit.branchCount, threadCount(circuit.branchCount, ASSEMBLY_ITEMS_PER_THREAD),
+        [&](size_t begin, size_t end, unsigned) {
+        for (size_t b = begin; b < end; b++) {
+            for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+                if (circuit.elementKinds[e] == ElementKind::Resistance)
+                    branch_impedances[b] += circuit.elementValues[e];
+                else
+                    branch_voltages[b] += circuit.elementValues[e];
+            }
         }
-        for (int index : ind){
-            string common_branch = "";
-            // Find the common branch impedance (elements outside the diagonal)
-            for (auto br_i : mVector[i].getBranchesIDs()) {
-                for (auto br_n : mVector[index].getBranchesIDs()) {
-                    if (br_n == br_i)
-                        common_branch = br_n;
+    });
+
+    // The mesh-branch incidence B is stored by meshes. Build its transpose, which
+    // lists the meshes that traverse each branch
+    BranchMeshes branch_meshes = findBranchMeshes(circuit);
+
+    // Build the voltages array, V = B x E, and the impedance matrix,
+    // R = B x diag(R) x B^T, one column at a time. The column j gets the impedance of
+    // every branch of the mesh j, added to the row of every mesh which shares that
+    // branch with the sign of both orientations. The matrix is symmetric, so its
+    // columns are also its rows.
+    // The meshes are split among the threads in contiguous ranges. Each thread writes
+    // the (row, impedance) pairs of its columns to its own buffer and compresses them,
+    // sorting each column by row and adding up the repeated rows
+    unsigned threads = threadCount(circuit.meshCount, ASSEMBLY_ITEMS_PER_THREAD);
+    vector<double> voltages(circuit.meshCount, 0.0);
+    vector<vector<pair<int, double>>> thread_entries(threads);
+    vector<vector<int>> thread_column_sizes(threads);
+    parallelFor(circuit.meshCount, threads, [&](size_t begin, size_t end, unsigned t) {
+        vector<pair<int, double>> &entries = thread_entries[t];
+        vector<int> &column_sizes = thread_column_sizes[t];
+        column_sizes.reserve(end - begin);
+        for (size_t j = begin; j < end; j++) {
+            size_t column_start = entries.size();
+            for (uint32_t k = circuit.meshBranchOffsets[j]; k < circuit.meshBranchOffsets[j + 1]; k++) {
+                uint32_t b = circuit.meshBranchIndices[k];
+                // A mesh that traverses a branch against its orientation sees the opposite voltage
+                voltages[j] += circuit.meshBranchSigns[k] * branch_voltages[b];
+                for (uint32_t l = branch_meshes.offsets[b]; l < branch_meshes.offsets[b + 1]; l++) {
+                    entries.emplace_back(static_cast<int>(branch_meshes.meshes[l]),
+                        circuit.meshBranchSigns[k] * branch_meshes.signs[l] * branch_impedances[b]);
                 }
             }
-            // Look for the branch that matches the common_branch ID
-            for (auto br : bVector) {
-                if (common_branch == br.ID) {
-                    // If a common branch exists, assign its impedance to the current element
-                    impedance_matrix[i][index] -= br.branchImpedance;
-                } else if (common_branch == "") {
-                    // If there is not any common branch, assign a zero to the current element
-                    impedance_matrix[i][index] -= 0.0;
-                }
+            // Compress the column
+            sort(entries.begin() + column_start, entries.end(),
+                [](const pair<int, double> &a, const pair<int, double> &b) { return a.first < b.first; });
+            size_t last = column_start;
+            for (size_t p = column_start; p < entries.size(); p++) {
+                if (last > column_start && entries[last - 1].first == entries[p].first)
+                    entries[last - 1].second += entries[p].second;
+                else
+                    entries[last++] = entries[p];
             }
+            entries.resize(last);
+            column_sizes.push_back(static_cast<int>(last - column_start));
         }
+    });
+
+    // Merge the buffers of all the threads, in the order of their columns
+    SparseMatrix impedance_matrix;
+    impedance_matrix.dim = static_cast<int>(circuit.meshCount);
+    impedance_matrix.columnOffsets.reserve(circuit.meshCount + 1);
+    impedance_matrix.columnOffsets.push_back(0);
+    vector<size_t> thread_offsets(threads, 0);
+    for (unsigned t = 0; t < threads; t++) {
+        thread_offsets[t] = impedance_matrix.columnOffsets.back();
+        for (int size : thread_column_sizes[t])
+            impedance_matrix.columnOffsets.push_back(impedance_matrix.columnOffsets.back() + size);
     }
-    return {impedance_matrix, voltages};
+    impedance_matrix.rowIndices.resize(impedance_matrix.columnOffsets.back());
+    impedance_matrix.values.resize(impedance_matrix.columnOffsets.back());
+    parallelFor(threads, threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t t = begin; t < end; t++) {
+            for (size_t p = 0; p < thread_entries[t].size(); p++) {
+                impedance_matrix.rowIndices[thread_offsets[t] + p] = thread_entries[t][p].first;
+                impedance_matrix.values[thread_offsets[t] + p] = thread_entries[t][p].second;
+            }
+        }
+    });
+    return {move(impedance_matrix), move(voltages), move(branch_meshes)};
 }
 
 
-void setCurrents(vector<Mesh> &mVector, vector<Branch> &bVector, vector<double> &currents){
+void setCurrents(const CircuitView &circuit, vector<double> &currents, CircuitResults &results) {
 
     // Assign the current through each mesh
-    for (int i = 0; i < mVector.size(); i++) {
-        mVector[i].setCurrent(currents[i]);
-    }
-
-    // Calculate the current through each branch by taking the current of its corresponding mesh
-    for(int i = 0; i < bVector.size(); i++) {
-        for(int j = 0; j < currents.size(); j++) {
-            for(auto br : mVector[j].getBranchesIDs()) {
-                if (br == bVector[i].ID) {
-                    if (bVector[i].current == 0) {
-                        // If we are assigning the current from the first mesh in
-                        // which this branch is included, then do not change the sign
-                        bVector[i].current += currents[j];
-                    } else {
-                        // If we are assigning the current from other mesh in which
-                        // this branch is included, then take the sign into account
-                        if (currents[j] > 0.0)
-                            bVector[i].current -= currents[j];
-                        else
-                            bVector[i].current += currents[j];
-                    }
-                }
-            }
+    results.meshCurrents.swap(currents);
+    const double *mesh_currents = results.meshCurrents.data();
+
+    // Calculate the current through each branch, Bt x I, by adding the current of
+    // every mesh that traverses it, taking its orientation into account
+    results.branchCurrents.assign(circuit.branchCount, 0.0);
+    double *branch_currents = results.branchCurrents.data();
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        double current = mesh_currents[i];
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++)
+            branch_currents[circuit.meshBranchIndices[k]] += circuit.meshBranchSigns[k] * current;
+    }
+
+    // Calculate dissipated powers in resistances
+    setElementPowers(circuit, results);
+}
+
+
+void setElementPowers(const CircuitView &circuit, CircuitResults &results) {
+    results.elementPowers.resize(circuit.elementCount);
+    if (circuit.elementCount == 0)
+        return;
+    double *powers = results.elementPowers.data();
+    const double *branch_currents = results.branchCurrents.data();
+    parallelFor(circuit.branchCount, threadCount(circuit.branchCount, POWER_ITEMS_PER_THREAD),
+        [&](size_t begin, size_t end, unsigned) {
+        // Give each element the squared current of its branch
+        for (size_t b = begin; b < end; b++) {
+            double squared_current = branch_currents[b] * branch_currents[b];
+            for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++)
+                powers[e] = squared_current;
         }
-        // Calculate dissipated powers in resistances
-        for(int l = 0; l < bVector[i].impedances.size(); l++) {
-            bVector[i].powerDissipated.push_back(pow( bVector[i].current, 2) * bVector[i].impedances[l]);
+
+        // Multiply it by the resistance, or drop it for batteries. The loop has no
+        // branches, so the compiler can vectorize it
+        uint32_t first = circuit.branchElementOffsets[begin];
+        uint32_t last = circuit.branchElementOffsets[end];
+        for (uint32_t e = first; e < last; e++) {
+            powers[e] = circuit.elementKinds[e] == ElementKind::Resistance ?
+                powers[e] * circuit.elementValues[e] : 0.0;
         }
-    }
+    });
 }
 
 
-void saveToFile(vector<Mesh> &mVector, vector<Branch> &bVector, string &fileName) {
+bool saveToFile(const CircuitView &circuit, CircuitResults &results, string &fileName) {
 
-    ofstream results_file;
     // Open the results file to write on it
-    results_file.open(fileName);
+    ResultsWriter writer;
+    if (!writer.open(fileName))
+        return false;
 
-    // Write to file
     // Write meshes current
-    results_file << "------------------" << endl;
-    results_file << "----- Meshes -----" << endl;
-    results_file << "------------------" << endl;
-    for(auto mesh : mVector){
-        results_file << "\nMesh with ID: " << mesh.getID() << ":" << endl;
-        results_file << "--> Current: " << mesh.getCurrent() << " (A)" << endl;
-    }
+    writer.text("------------------\n");
+    writer.text("----- Meshes -----\n");
+    writer.text("------------------\n");
+    formatItems(writer, circuit.meshCount, true, [&](ResultsWriter &out, size_t i) {
+        out.text("\nMesh with ID: ").text(circuit.string(circuit.meshIDs[i])).text(":\n");
+        out.text("--> Current: ").number(results.meshCurrents[i]).text(" (A)\n");
+    });
 
     // Write branches current
-    results_file << "\n------------------" << endl;
-    results_file << "---- Branches ----" << endl;
-    results_file << "------------------" << endl;
-    for(auto branch : bVector){
-        results_file << "\nBranch with ID: " << branch.ID << ":" << endl;
-        results_file << "--> Current: " << branch.current << " (A)" << endl;
-        for(int i = 0; i < branch.impedanceIDs.size(); i++) {
-            results_file << "--> Power dissipated by " << branch.impedanceIDs[i] << ": " 
-                         << branch.powerDissipated[i] << " (W)" << endl;
-       }
+    writer.text("\n------------------\n");
+    writer.text("---- Branches ----\n");
+    writer.text("------------------\n");
+    formatItems(writer, circuit.branchCount, true, [&](ResultsWriter &out, size_t b) {
+        out.text("\nBranch with ID: ").text(circuit.string(circuit.branchIDs[b])).text(":\n");
+        out.text("--> Current: ").number(results.branchCurrents[b]).text(" (A)\n");
+        for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+            if (circuit.elementKinds[e] == ElementKind::Resistance) {
+                out.text("--> Power dissipated by ").text(circuit.string(circuit.elementIDs[e])).text(": ")
+                   .number(results.elementPowers[e]).text(" (W)\n");
+            }
+        }
+    });
+    // Close the results file
+    return writer.close();
+}
+
+
+bool saveProbesToFile(const CircuitView &circuit, ResultsView &results, const Probes &probes, string &fileName) {
+
+    // Compute the currents of every branch needed at once
+    vector<uint32_t> branches = probes.branches;
+    for (uint32_t e : probes.elements)
+        branches.push_back(results.elementBranch(e));
+    results.evaluate(branches);
+
+    // Open the results file to write on it
+    ResultsWriter writer;
+    if (!writer.open(fileName))
+        return false;
+
+    // Write the requested meshes current
+    if (!probes.meshes.empty()) {
+        writer.text("------------------\n");
+        writer.text("----- Meshes -----\n");
+        writer.text("------------------\n");
+        for (uint32_t i : probes.meshes) {
+            writer.text("\nMesh with ID: ").text(circuit.string(circuit.meshIDs[i])).text(":\n");
+            writer.text("--> Current: ").number(results.meshCurrent(i)).text(" (A)\n");
+        }
+    }
+
+    // Write the requested branches current
+    if (!probes.branches.empty()) {
+        writer.text("\n------------------\n");
+        writer.text("---- Branches ----\n");
+        writer.text("------------------\n");
+        for (uint32_t b : probes.branches) {
+            writer.text("\nBranch with ID: ").text(circuit.string(circuit.branchIDs[b])).text(":\n");
+            writer.text("--> Current: ").number(results.branchCurrent(b)).text(" (A)\n");
+        }
+    }
+
+    // Write the requested elements power
+    if (!probes.elements.empty()) {
+        writer.text("\n------------------\n");
+        writer.text("---- Elements ----\n");
+        writer.text("------------------\n");
+        for (uint32_t e : probes.elements) {
+            writer.text("\n--> Power dissipated by ").text(circuit.string(circuit.elementIDs[e])).text(": ")
+                  .number(results.elementPower(e)).text(" (W)\n");
+        }
     }
     // Close the results file
-    results_file.close();
+    return writer.close();
 }
 
 
-int main(int argc, char *argv[]) {
-    // Check if a circuit file has been provided as an argument
-    if (argv[1] != nullptr) {
-        string input_file = argv[1];
+bool saveRecords(const CircuitView &circuit, ResultsView &results, const Probes *probes,
+    const ResultFields &fields, RecordFormat format, ResultsWriter &writer) {
 
-        // Check if it is a valid XML file
-        if (input_file.substr(input_file.length() - 3) == "xml") {
-            cout << "Reading circuit file: " << input_file << endl;
+    if (format == RecordFormat::Csv)
+        writer.text("kind,ID,quantity,value\n");
 
-            // Read the input data file
-            pugi::xml_document xml_file;
-            auto res = xml_file.load_file(argv[1]);
-            
-            // Check if it was loaded
-            if (res == false) {
-                cout << "ERROR: There were problems loading " << input_file << endl;
-                cout << "ERROR: " << res.description() << endl;
-                cout << "Error offset: " << res.offset << endl;
-                system("pause");
-            } else {
-                // Get the meshes XML node
-                pugi::xml_node meshes_node = xml_file.child("circuit");
+    if (probes != nullptr) {
+        // Compute the currents of every branch needed at once
+        vector<uint32_t> branches;
+        if (fields.branches)
+            branches = probes->branches;
+        if (fields.elements) {
+            for (uint32_t e : probes->elements)
+                branches.push_back(results.elementBranch(e));
+        }
+        results.evaluate(branches);
 
-                // Read meshes
-                for(auto mesh_node : meshes_node.children("mesh")) {
-                    // Push this mesh to the meshesVector
-                    meshesVector.push_back(Mesh(mesh_node.attribute("ID").as_string(), mesh_node));
-                }
+        // Write the requested items
+        for (uint32_t i : fields.meshes ? probes->meshes : vector<uint32_t>())
+            writeRecord(writer, format, "mesh", circuit.string(circuit.meshIDs[i]), "current", results.meshCurrent(i));
+        for (uint32_t b : fields.branches ? probes->branches : vector<uint32_t>())
+            writeRecord(writer, format, "branch", circuit.string(circuit.branchIDs[b]), "current", results.branchCurrent(b));
+        for (uint32_t e : fields.elements ? probes->elements : vector<uint32_t>())
+            writeRecord(writer, format, "element", circuit.string(circuit.elementIDs[e]), "power", results.elementPower(e));
+        return writer.close();
+    }
+
+    // Write every mesh, branch and resistance, in parallel if the view does not have to
+    // compute anything
+    bool parallel = results.isComplete();
+    if (fields.meshes) {
+        formatItems(writer, circuit.meshCount, parallel, [&](ResultsWriter &out, size_t i) {
+            writeRecord(out, format, "mesh", circuit.string(circuit.meshIDs[i]), "current", results.meshCurrent(i));
+        });
+    }
+    if (fields.branches) {
+        formatItems(writer, circuit.branchCount, parallel, [&](ResultsWriter &out, size_t b) {
+            writeRecord(out, format, "branch", circuit.string(circuit.branchIDs[b]), "current", results.branchCurrent(b));
+        });
+    }
+    if (fields.elements) {
+        formatItems(writer, circuit.elementCount, parallel, [&](ResultsWriter &out, size_t e) {
+            if (circuit.elementKinds[e] == ElementKind::Resistance)
+                writeRecord(out, format, "element", circuit.string(circuit.elementIDs[e]), "power", results.elementPower(e));
+        });
+    }
+    return writer.close();
+}
+
+
+SystemSize meshSystemSize(const CircuitView &circuit) {
+    // Each branch couples every pair of different meshes that traverse it
+    vector<uint32_t> branch_meshes(circuit.branchCount, 0);
+    for (uint32_t k = 0; k < circuit.incidenceCount(); k++)
+        branch_meshes[circuit.meshBranchIndices[k]]++;
+
+    SystemSize size;
+    size.dimension = circuit.meshCount;
+    size.nonZeros = circuit.meshCount;
+    for (uint32_t count : branch_meshes) {
+        if (count > 1)
+            size.nonZeros += static_cast<size_t>(count) * (count - 1);
+    }
+    return size;
+}
+
+
+SolverEngine chooseEngine(const CircuitView &circuit, SolverEngine requested) {
+    // Nodal analysis needs the nodes of the circuit
+    if (circuit.nodeCount == 0)
+        return SolverEngine::Mesh;
+    if (requested != SolverEngine::Auto)
+        return requested;
+
+    // Take the system with the fewest non-zero elements, or the smallest one
+    SystemSize mesh = meshSystemSize(circuit);
+    SystemSize nodal = nodalSystemSize(circuit);
+    if (nodal.nonZeros != mesh.nonZeros)
+        return nodal.nonZeros < mesh.nonZeros ? SolverEngine::Nodal : SolverEngine::Mesh;
+    return nodal.dimension < mesh.dimension ? SolverEngine::Nodal : SolverEngine::Mesh;
+}
+
+
+bool solveCircuit(CircuitContext &context) {
+    CircuitView circuit = context.view();
+
+    if (chooseEngine(circuit, context.engine) == SolverEngine::Nodal) {
+        // Create and solve the nodal system
+        context.nodalSystem = createNodalSystem(circuit);
+        SparseMatrix &matrix = context.nodalSystem.conductanceMatrix;
+        vector<double> solution = solveSystem(matrix, context.nodalSystem.currents);
+        if (solution.empty() && matrix.dim > 0)
+            return false;
+
+        // Assign the currents to each mesh and branch
+        setNodalCurrents(circuit, context.nodalSystem, solution, context.results.meshCurrents,
+            context.results.branchCurrents);
+        if (context.deferResults)
+            context.results.elementPowers.clear();
+        else
+            setElementPowers(circuit, context.results);
+        return true;
+    }
+
+    // Create the equation system
+    context.system = createSystem(circuit);
+
+    // Solve the equation system, keeping the decomposition of its matrix
+    SparseMatrix &matrix = context.system.impedanceMatrix;
+    context.factorization = LUdecomposition(matrix);
+    context.dirtyColumn = matrix.dim;
+    if (context.factorization.singular && matrix.dim > 0)
+        return false;
+    vector<double> currents = solveLU(context.factorization, context.system.voltages);
 
-                cout << "\n" << "Solving circuit..." << endl;
-                clock_t begin = clock();
+    // Assign the currents to each mesh and branch
+    if (context.deferResults) {
+        context.results.meshCurrents = move(currents);
+        context.results.branchCurrents.clear();
+        context.results.elementPowers.clear();
+    } else {
+        setCurrents(circuit, currents, context.results);
+    }
+    return true;
+}
 
-                // Create the equation system
-                System system_data = createSystem(meshesVector, branchesVector);
 
-                // Solve the equation system
-                vector<double> currents = solveSystem(system_data.impedanceMatrix, system_data.voltages);
+bool saveResults(CircuitContext &context, const ResultsOptions &options, string &fileName, streambuf *output) {
+    CircuitView circuit = context.view();
+    const string &format = options.format;
+    Probes probes;
+    if (context.deferResults) {
+        vector<string> missing;
+        probes = findProbes(circuit, options.probeIDs, missing);
+        for (const string &ID : missing)
+            logMessage(LogLevel::Error, "WARNING: There is no mesh, branch or element with ID ", ID);
+    }
+    // Reuse the transpose of the incidence built with the system, so probing a few
+    // branches doesn't build it again
+    const BranchMeshes &branch_meshes = context.system.branchMeshes;
+    bool built = branch_meshes.offsets.size() == circuit.branchCount + 1;
+    ResultsView results(circuit, context.results.meshCurrents, context.results.branchCurrents,
+        context.results.elementPowers, built ? &branch_meshes : nullptr);
+    if (format == "binary") {
+        if (!options.probeIDs.empty())
+            logMessage(LogLevel::Error, "WARNING: Binary results hold the whole circuit, the probes are ignored");
+        return saveResultsFile(circuit, context.results.meshCurrents, context.results.branchCurrents,
+            context.results.elementPowers, fileName);
+    }
+    if (format == "csv" || format == "jsonl") {
+        ResultsWriter writer;
+        if (output != nullptr)
+            writer.open(output);
+        return (output != nullptr || writer.open(fileName)) &&
+            saveRecords(circuit, results, context.deferResults ? &probes : nullptr, options.fields,
+                format == "csv" ? RecordFormat::Csv : RecordFormat::JsonLines, writer);
+    }
+    if (context.deferResults)
+        return saveProbesToFile(circuit, results, probes, fileName);
+    return saveToFile(circuit, context.results, fileName);
+}
+
+
+string resultsFileName(const string &inputFile, const string &format) {
+    string base_name = inputFile.length() > 4 ? inputFile.substr(0, inputFile.length() - 4) : inputFile;
+    return base_name + "_solved." + (format == "text" ? "txt" : format == "binary" ? "bin" : format);
+}
+
+
+int main(int argc, char *argv[]) {
+    // Allocate the XML documents from per-thread arenas
+    installXmlArena();
 
-                // Assign the currents to each branch
-                setCurrents(meshesVector, branchesVector, currents);
-                clock_t end = clock();
-                double elapsed_secs = double(end - begin) * 1000 / CLOCKS_PER_SEC;
-                cout << "\n" << "Circuit solved in " << elapsed_secs << " miliseconds" << endl;
+    // A batch never waits for the user, not even after an invalid option
+    bool batch = find(argv + 1, argv + argc, string("--batch")) != argv + argc;
+    bool serve = any_of(argv + 1, argv + argc, [](const char *argument) {
+        return string(argument).compare(0, 8, "--serve=") == 0;
+    });
+    interactive = !batch && !serve;
+    int failure = interactive ? 0 : EXIT_FAILURE;
 
-                // Save results to file
-                string results_file_name = input_file.substr(0, input_file.length() - 4) + "_solved.txt";
-                cout << "\n" << "Saving results to " << results_file_name << endl;
-                saveToFile(meshesVector, branchesVector, results_file_name);
-                cout << "\nDONE!\n" << endl;
-                system("pause");
+    // Read the options and the circuit files
+    bool compile = false;
+    SolverEngine engine = SolverEngine::Auto;
+    ResultsOptions results_options;
+    string &format = results_options.format;
+    ResultFields &fields = results_options.fields;
+    const char *output_argument = nullptr;
+    const char *socket_argument = nullptr;
+    vector<SweepParameter> sweeps;
+    bool sensitivity = false;
+    size_t samples = 0;
+    uint64_t seed = 1;
+    const char *tolerances_argument = nullptr;
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--batch") {
+            // Every other argument is a circuit file, a directory, a pattern or a manifest
+        } else if (argument == "--compile") {
+            // The circuit has to be compiled instead of solved
+            compile = true;
+        } else if (argument == "--sensitivity") {
+            // The derivatives of the currents of the probes have to be found instead
+            sensitivity = true;
+        } else if (argument == "--verbose") {
+            // Tell every mesh and branch read
+            setLogLevel(LogLevel::Verbose);
+        } else if (argument == "--trace") {
+            // Tell every mesh, branch and element read
+            setLogLevel(LogLevel::Trace);
+        } else if (argument.compare(0, 9, "--engine=") == 0) {
+            string engine_name = argument.substr(9);
+            if (engine_name == "mesh") {
+                engine = SolverEngine::Mesh;
+            } else if (engine_name == "mna") {
+                engine = SolverEngine::Nodal;
+            } else if (engine_name != "auto") {
+                logMessage(LogLevel::Error, "ERROR: Unknown engine ", engine_name, ", it must be mesh, mna or auto");
+                pauseConsole();
+                return failure;
             }
+        } else if (argument.compare(0, 9, "--format=") == 0) {
+            format = argument.substr(9);
+            if (format != "text" && format != "binary" && format != "csv" && format != "jsonl") {
+                logMessage(LogLevel::Error, "ERROR: Unknown format ", format,
+                    ", it must be text, binary, csv or jsonl");
+                pauseConsole();
+                return failure;
+            }
+        } else if (argument.compare(0, 9, "--fields=") == 0) {
+            // Only these kinds of results have to be written as records
+            fields.meshes = fields.branches = fields.elements = false;
+            for (const string &field : splitList(argument.substr(9))) {
+                if (field == "mesh") {
+                    fields.meshes = true;
+                } else if (field == "branch") {
+                    fields.branches = true;
+                } else if (field == "element") {
+                    fields.elements = true;
+                } else {
+                    logMessage(LogLevel::Error, "ERROR: Unknown field ", field, ", it must be mesh, branch or element");
+                    pauseConsole();
+                    return failure;
+                }
+            }
+        } else if (argument.compare(0, 9, "--output=") == 0) {
+            output_argument = argv[i] + 9;
+        } else if (argument.compare(0, 8, "--sweep=") == 0) {
+            // The circuit has to be solved for these values of an element
+            SweepParameter sweep;
+            if (!parseSweep(argument.substr(8), sweep)) {
+                logMessage(LogLevel::Error, "ERROR: Invalid sweep ", argument.substr(8),
+                    ", it must be ID=value,value,... or ID=start:stop:count");
+                pauseConsole();
+                return failure;
+            }
+            sweeps.push_back(sweep);
+        } else if (argument.compare(0, 13, "--montecarlo=") == 0 || argument.compare(0, 7, "--seed=") == 0) {
+            // The number of random samples, or the seed of their values
+            size_t equals = argument.find('=');
+            char *end;
+            unsigned long long number = strtoull(argument.c_str() + equals + 1, &end, 10);
+            if (equals + 1 == argument.size() || *end != '\0' || argument[equals + 1] == '-') {
+                logMessage(LogLevel::Error, "ERROR: Invalid number in ", argument);
+                pauseConsole();
+                return failure;
+            }
+            if (argument[2] == 'm')
+                samples = static_cast<size_t>(number);
+            else
+                seed = number;
+        } else if (argument.compare(0, 13, "--tolerances=") == 0) {
+            tolerances_argument = argv[i] + 13;
+        } else if (argument.compare(0, 8, "--serve=") == 0) {
+            socket_argument = argv[i] + 8;
+        } else if (argument.compare(0, 8, "--probe=") == 0) {
+            // Only the results of these comma separated IDs have to be written
+            for (const string &ID : splitList(argument.substr(8)))
+                results_options.probeIDs.push_back(ID);
+        } else if (batch || inputs.empty()) {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (serve) {
+        // Keep the circuits of the clients solved until one of them stops the server
+        SolverServer server;
+        if (!server.open(socket_argument)) {
+            logMessage(LogLevel::Error, "ERROR: ", server.getError());
+            flushLog();
+            return EXIT_FAILURE;
+        }
+        server.run();
+        flushLog();
+        return 0;
+    }
+
+    // Check if a circuit file has been provided as an argument
+    if (inputs.empty()) {
+        logMessage(LogLevel::Error, "PLEASE PROVIDE AN XML INPUT FILE");
+        pauseConsole();
+        return failure;
+    }
+
+    if (batch) {
+        // Solve every circuit, each results file is named after its circuit file
+        if (output_argument != nullptr)
+            logMessage(LogLevel::Error, "WARNING: A batch writes a results file per circuit, the output is ignored");
+        BatchOptions batch_options;
+        batch_options.compile = compile;
+        batch_options.engine = engine;
+        batch_options.results = results_options;
+        int status = solveBatch(inputs, batch_options);
+        flushLog();
+        return status;
+    }
+    string input_file = inputs.front();
+    string base_name = input_file.length() > 4 ? input_file.substr(0, input_file.length() - 4) : input_file;
+    bool records = format == "csv" || format == "jsonl";
+
+    // Records written to the standard output are kept apart from the messages,
+    // which go to the standard error then
+    string results_file_name = output_argument != nullptr ? string(output_argument) :
+        resultsFileName(input_file, format);
+    bool to_standard_output = results_file_name == "-";
+    if (to_standard_output && (!records || !sweeps.empty() || samples > 0 || sensitivity)) {
+        logMessage(LogLevel::Error, "ERROR: Only csv and jsonl results can be written to the standard output");
+        pauseConsole();
+        return 0;
+    }
+    flushLog();
+    streambuf *standard_output = cout.rdbuf();
+    if (to_standard_output)
+        cout.rdbuf(cerr.rdbuf());
+
+    // Only XML files can be compiled
+    if (compile && (input_file.length() <= 3 || input_file.substr(input_file.length() - 3) != "xml")) {
+        logMessage(LogLevel::Error, "INVALID INPUT FILE, PLEASE PROVIDE AN XML INPUT FILE");
+        pauseConsole();
+        return 0;
+    }
+
+    // Read or map the circuit
+    CircuitContext context;
+    context.engine = engine;
+    context.deferResults = !results_options.probeIDs.empty() && format != "binary";
+    if (!loadCircuit(input_file, context)) {
+        pauseConsole();
+        return 0;
+    }
+
+    if (compile) {
+        // Save the circuit to a compiled circuit file
+        string compiled_file_name = base_name + ".csb";
+        logMessage(LogLevel::Info, "\nCompiling circuit to ", compiled_file_name);
+        if (compileCircuit(context.view(), compiled_file_name)) {
+            logMessage(LogLevel::Info, "\nDONE!\n");
         } else {
-            cout << "INVALID INPUT FILE, PLEASE PROVIDE AN XML INPUT FILE" << endl;
-            system("pause");
+            logMessage(LogLevel::Error, "ERROR: There were problems writing ", compiled_file_name);
         }
-    } else {
-        cout << "PLEASE PROVIDE AN XML INPUT FILE" << endl;
-        system("pause");
+        pauseConsole();
+        return 0;
+    }
+
+    if (sensitivity) {
+        // Find the derivatives of the currents of the probes with one adjoint solve each
+        string sensitivity_file_name = output_argument != nullptr ? string(output_argument) :
+            base_name + "_sensitivity.csv";
+        logMessage(LogLevel::Info, "\nFinding the sensitivities of the circuit with mesh analysis...");
+        clock_t begin = clock();
+        if (!runSensitivity(context, results_options, sensitivity_file_name)) {
+            pauseConsole();
+            return 0;
+        }
+        double elapsed_secs = double(clock() - begin) * 1000 / CLOCKS_PER_SEC;
+        logMessage(LogLevel::Info, "\nSensitivities found and saved to ", sensitivity_file_name, " in ",
+            elapsed_secs, " miliseconds");
+        logMessage(LogLevel::Info, "\nDONE!\n");
+        pauseConsole();
+        return 0;
+    }
+
+    if (samples > 0) {
+        // Solve the circuit for random values of its elements within their tolerances
+        string tolerances_file_name = tolerances_argument != nullptr ? string(tolerances_argument) :
+            base_name + ".tol";
+        string statistics_file_name = output_argument != nullptr ? string(output_argument) :
+            base_name + "_montecarlo.csv";
+        vector<Tolerance> tolerances;
+        if (!readTolerances(tolerances_file_name, context.view(), tolerances)) {
+            pauseConsole();
+            return 0;
+        }
+        logMessage(LogLevel::Info, "\nSolving ", samples, " samples of the circuit with mesh analysis...");
+        auto begin = chrono::steady_clock::now();
+        if (!runMonteCarlo(context, tolerances, samples, seed, results_options, statistics_file_name)) {
+            pauseConsole();
+            return 0;
+        }
+        double elapsed_secs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        logMessage(LogLevel::Info, "\nSamples solved and statistics saved to ", statistics_file_name, " in ",
+            elapsed_secs, " miliseconds");
+        logMessage(LogLevel::Info, "\nDONE!\n");
+        pauseConsole();
+        return 0;
+    }
+
+    if (!sweeps.empty()) {
+        // Solve the circuit for every point of the sweep, always with mesh analysis
+        string sweep_file_name = output_argument != nullptr ? string(output_argument) : base_name + "_sweep.csv";
+        if (format != "text" && format != "csv")
+            logMessage(LogLevel::Error, "WARNING: Sweeps are always written as csv, the format is ignored");
+        logMessage(LogLevel::Info, "\nSweeping the circuit with mesh analysis...");
+        clock_t begin = clock();
+        if (!runSweep(context, sweeps, results_options, sweep_file_name)) {
+            pauseConsole();
+            return 0;
+        }
+        double elapsed_secs = double(clock() - begin) * 1000 / CLOCKS_PER_SEC;
+        logMessage(LogLevel::Info, "\nSweep solved and saved to ", sweep_file_name, " in ", elapsed_secs,
+            " miliseconds");
+        logMessage(LogLevel::Info, "\nDONE!\n");
+        pauseConsole();
+        return 0;
+    }
+
+    // Tell which engine solves the circuit
+    CircuitView circuit = context.view();
+    if (engine == SolverEngine::Nodal && circuit.nodeCount == 0)
+        logMessage(LogLevel::Error, "\nWARNING: Only circuits given as a netlist can be solved with nodal analysis");
+    if (chooseEngine(circuit, engine) == SolverEngine::Nodal)
+        logMessage(LogLevel::Info, "\nSolving circuit with modified nodal analysis...");
+    else
+        logMessage(LogLevel::Info, "\nSolving circuit with mesh analysis...");
+    clock_t begin = clock();
+
+    // Create and solve the equation system
+    if (!solveCircuit(context)) {
+        logMessage(LogLevel::Error, "ERROR: The circuit can't be solved, its impedance matrix is singular");
+        pauseConsole();
+        return 0;
+    }
+    clock_t end = clock();
+    double elapsed_secs = double(end - begin) * 1000 / CLOCKS_PER_SEC;
+    logMessage(LogLevel::Info, "\nCircuit solved in ", elapsed_secs, " miliseconds");
+
+    // Save results to file
+    logMessage(LogLevel::Info, "\nSaving results to ", to_standard_output ? "the standard output" : results_file_name);
+    if (!saveResults(context, results_options, results_file_name, to_standard_output ? standard_output : nullptr)) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", results_file_name);
+        pauseConsole();
+        return 0;
     }
+    logMessage(LogLevel::Info, "\nDONE!\n");
+    if (!to_standard_output)
+        pauseConsole();
     return 0;
 }
@@ -23,129 +23,93 @@ limitations under the License.
  * to build and solve the circuit.
  */
 
+#pragma once
 #include <iostream>
 #include <vector>
 #include <iterator>
 #include <ctime>
+#include <cmath>
 #include <fstream>
 #include "pugixml.hpp"
 #include "LinearSystemSolver.h"
+#include "CircuitView.h"
+#include "CircuitModel.h"
+#include "CircuitFile.h"
+#include "NodalAnalysis.h"
+#include "ResultsView.h"
+#include "ResultsWriter.h"
+
 
 /*!
- * \brief An electric mesh.
- *
- * A class that represents the electric mesh
- */
-class Mesh {
-
-    private:
-        std::string ID = "";                    // The mesh identifier
-        double m_powerSource = 0;               // The total mesh voltage  (V)
-        double m_impedance = 0;                 // The total mesh impedance (Ω)
-        double m_current = 0;                   // The resulting mesh current (A)
-        std::vector<std::string> m_branchesIDs; // Vector which stores the IDs of the mesh branches
-
-    public:
-        /*!
-        * \brief Default constructor.
-        *
-        * Initialises the mesh.
-        * 
-        * \param t_ID   ID assigned to the mesh
-        * \param t_mesh The XML node that defines the mesh
-        */
-        Mesh(std::string t_ID, pugi::xml_node t_mesh);
-        
-        /*!
-        * \brief Destructor.
-        *
-        * Destructs the mesh.
-        * 
-        * Note: we are not going to call this destructor since the meshes are not going to be removed.
-        */
-        ~Mesh();
-
-        /*!
-        * \brief Function to read the mesh elements defined in the XML node.
-        * 
-        * \param t_mesh The XML node that defines the mesh.
-        */
-        void readElements(pugi::xml_node t_mesh);
-
-
-        /*!
-        * \brief Function that returns the mesh voltage.
-        * 
-        * \return The mesh voltage
-        */
-        double getPowerSource() {
-            return m_powerSource;
-        };
-
-        /*!
-        * \brief Function that returns IDs of the branches in the mesh
-        * 
-        * \return The IDs of the branches in the mesh
-        */
-        std::vector<std::string> getBranchesIDs() {
-            return m_branchesIDs;
-        };
-
-        /*!
-        * \brief Function that returns the mesh impedance
-        * 
-        * \return The mesh impedance
-        */
-        double getImpedance() {
-            return m_impedance;
-        };
-
-        /*!
-        * \brief Function that returns the mesh ID
-        * 
-        * \return The mesh ID
-        */
-        std::string getID() {
-            return ID;
-        }
-
-        /*!
-        * \brief Function that assign the already calculated mesh current.
-        */
-        void setCurrent(double t_current) {
-            m_current = t_current;
-        }
-
-        /*!
-        * \brief Function that returns the mesh current
-        * 
-        * \return The mesh current
-        */
-        double getCurrent() {
-            return m_current;
-        }
+* \brief Function that reads the value of a circuit element.
+* 
+* The value attribute is decoded once by parseValue, so it may use engineering
+* suffixes. An invalid value is reported and taken as zero.
+* 
+* \param t_element The XML node that defines the element
+* 
+* \return The element value (Ω or V)
+*/
+double readValue(pugi::xml_node t_element);
 
-};
 
+/*!
+* \brief Function that reads the orientation sign of a branch referenced by a mesh.
+* 
+* \param t_reference The XML node that references the branch
+* 
+* \return +1 if the mesh traverses the branch in its direction ("+", the default), -1 otherwise ("-")
+*/
+int readSign(pugi::xml_node t_reference);
 
 /*!
- * \brief An electric branch.
- *
- * An struct which defines a branch. A branch is a set of elements in a mesh portion
- * between two consecutive nodes.
- */
-struct Branch {
-    std::string ID;                         // The branch ID
-    double current;                         // The resulting branch current (A)
-    double branchImpedance;                 // The branch impedance (Ω)
-    std::vector<std::string> impedanceIDs;  // The IDs of the impedances in the branch
-    std::vector<double> impedances;         // The values of the impedances in the branch (Ω)
-    std::vector<double> powerDissipated;    // The resulting power dissipated by each impedance of the branch (W)
-};
+* \brief Function that reads the branches defined in the <branches> section of a circuit.
+* 
+* Each branch is defined once, with the elements it holds, and added to the model.
+* 
+* \param t_branches The XML node of the <branches> section
+* \param t_model The model where the branches are added
+*/
+void readBranches(pugi::xml_node t_branches, CircuitModel &t_model);
+
+/*!
+* \brief Function that reads a mesh and adds it to the model.
+* 
+* If the circuit has a <branches> section, the mesh only references the branches
+* defined there, each one with the sign of its orientation. Otherwise, the mesh
+* declares its branches and their elements: the first mesh that declares a branch
+* defines its orientation and its elements, and the other meshes traverse it in the
+* opposite direction.
+* 
+* \param t_mesh The XML node that defines the mesh
+* \param t_model The model where the mesh is added
+*/
+void readMesh(pugi::xml_node t_mesh, CircuitModel &t_model);
 
-std::vector<Mesh> meshesVector;     // The vector of meshes
+/*!
+* \brief Function that reads a circuit given by the nodes its branches connect.
+* 
+* The <netlist> section holds <branch> nodes, with their elements inside, and bare
+* <battery> and <resistance> nodes, each one a branch on its own. All of them have
+* the from and to attributes, the nodes the branch connects: its current and the
+* voltage of its batteries are positive from the node from to the node to.
+* The meshes of the circuit are the independent loops found by findLoops.
+* 
+* \param t_netlist The XML node of the <netlist> section
+* \param t_model The model where the branches and meshes are added
+*/
+void readNetlist(pugi::xml_node t_netlist, CircuitModel &t_model);
 
-std::vector<Branch> branchesVector; // The vector of branches
+/*!
+* \brief Function that reads a whole circuit into a model.
+* 
+* A circuit is either a <netlist> section, or its meshes and, optionally, a
+* <branches> section.
+* 
+* \param t_circuit The <circuit> XML node
+* \param t_model The model to be filled, which must be empty
+*/
+void readCircuit(pugi::xml_node t_circuit, CircuitModel &t_model);
 
 /*!
  * \brief A linear equations system.
@@ -155,43 +119,260 @@ std::vector<Branch> branchesVector; // The vector of branches
  * R is the impedance matrix of the circuit,
  * I is the vector of mesh currents and
  * V is the vector of mesh voltages
+ * The transpose of the incidence used to build it is kept, so the results of a
+ * few branches can be computed later without building it again.
  */
 struct System {
-    std::vector<std::vector<double>> impedanceMatrix;   // The impedance matrix of the circuit (Ω)
-    std::vector<double> voltages;                       // The vector of mesh voltages (V)
+    SparseMatrix impedanceMatrix;       // The impedance matrix of the circuit (Ω)
+    std::vector<double> voltages;       // The vector of mesh voltages (V)
+    BranchMeshes branchMeshes;          // The meshes that traverse each branch, or empty if the branches changed
+};
+
+/*!
+ * \brief The results of a packed circuit.
+ *
+ * An struct which holds the currents and powers of a circuit given as a CircuitView,
+ * indexed in the same way as the meshes, branches and elements of the view.
+ */
+struct CircuitResults {
+    std::vector<double> meshCurrents;       // The current through each mesh (A)
+    std::vector<double> branchCurrents;     // The current through each branch (A)
+    std::vector<double> elementPowers;      // The power dissipated by each element (W), zero for batteries
+};
+
+/*!
+ * \brief The method used to solve a circuit.
+ */
+enum class SolverEngine {
+    Auto,           // The method that gives the smallest and sparsest system
+    Mesh,           // Mesh analysis, the unknowns are the mesh currents
+    Nodal           // Modified nodal analysis, the unknowns are the node voltages
+};
+
+/*!
+ * \brief A circuit being solved.
+ *
+ * An struct which owns everything the program holds for one circuit: the circuit
+ * itself, either read from an XML file into a model or mapped from a compiled file,
+ * its equations system and its results. With mesh analysis, the decomposition of the
+ * impedance matrix is kept, so a CircuitEditor can update it after small edits.
+ */
+struct CircuitContext {
+    CircuitModel model;                 // The circuit, if it was read from an XML file
+    MappedCircuit compiled;             // The circuit, if it was mapped from a compiled file
+    bool isCompiled = false;            // true if the circuit was mapped from a compiled file
+    SolverEngine engine = SolverEngine::Auto; // The method requested to solve the circuit
+    System system;                      // The equations system of the circuit, with mesh analysis
+    SparseLU factorization;             // The decomposition of the impedance matrix of the system
+    int dirtyColumn = 0;                // The first column of the impedance matrix changed since it was factorized
+    NodalSystem nodalSystem;            // The equations system of the circuit, with nodal analysis
+    CircuitResults results;             // The currents and powers of the circuit
+    bool deferResults = false;          // true to leave the branch currents and powers to a ResultsView
+
+    /*!
+    * \brief Function that returns the packed view of the circuit.
+    *
+    * \return The view of the circuit
+    */
+    CircuitView view() const {
+        return isCompiled ? compiled.view() : model.view();
+    }
 };
 
 /*!
-* \brief Function that returns the linear equations system to be solved.
+* \brief Function that loads a circuit file into a context.
+* 
+* XML files are read into the model of the context, and compiled circuit files
+* are mapped. Any problem is reported.
+* 
+* \param t_fileName The name of the circuit file (.xml or .csb)
+* \param t_context The context where the circuit is loaded
+* 
+* \return true if the circuit was loaded, false otherwise
+*/
+bool loadCircuit(const std::string &t_fileName, CircuitContext &t_context);
+
+/*!
+* \brief Function that returns the linear equations system of a packed circuit.
+* 
+* With B the signed mesh-branch incidence matrix, R the diagonal matrix of branch
+* impedances and E the vector of branch voltages, the impedance matrix is B x R x B^T
+* and the vector of voltages is B x E. The product is computed column by column from
+* the incidence and its transpose, so its cost grows with the number of non-zeros of
+* the result, and every branch shared by two meshes is taken into account.
 * 
-* \param t_meshesVector The vector of meshes
-* \param t_branchesVector The vector of branches 
+* Large circuits are assembled by several threads, each one in charge of a range of
+* meshes. The result does not depend on the number of threads, and the rows of each
+* column of the impedance matrix are sorted.
+* 
+* \param t_circuit The packed circuit
 * 
 * \return the linear equations system struct (impedance matrix and vector of voltages)
 */
-System createSystem(std::vector<Mesh> &t_meshesVector, std::vector<Branch> &t_branchesVector);
+System createSystem(const CircuitView &t_circuit);
 
 /*!
-* \brief Function that assigns the already calculated currents to each mesh and branch.
+* \brief Function that computes the currents and powers of a packed circuit.
 * 
-* It also calculates the power dissipated by each impedance.
+* The branch currents are the product of the transposed mesh-branch incidence by the
+* mesh currents, computed in one pass over the incidence.
 * 
-* \param t_meshesVector The vector of meshes
-* \param t_branchesVector The vector of branches
-* \param t_currents The vector of meshes current (A)
+* \param t_circuit The packed circuit
+* \param t_currents The vector of meshes current (A), which is exchanged with the one of the results
+* \param t_results The results struct to be filled
 */
-void setCurrents(std::vector<Mesh> &t_meshesVector, std::vector<Branch> &t_branchesVector,
-    std::vector<double> &t_currents);
+void setCurrents(const CircuitView &t_circuit, std::vector<double> &t_currents, CircuitResults &t_results);
 
 /*!
-* \brief Function that save the results into a text file.
+* \brief Function that computes the power dissipated by each resistance of a packed circuit.
+* 
+* The powers are written into the array of the results, which is reused if it already
+* has the right size. Large circuits are computed by several threads.
 * 
-* \param t_meshesVector The vector of meshes
-* \param t_branchesVector The vector of branches
+* \param t_circuit The packed circuit
+* \param t_results The results struct, whose branch currents are already known
+*/
+void setElementPowers(const CircuitView &t_circuit, CircuitResults &t_results);
+
+/*!
+ * \brief The machine-readable text formats of the results.
+ */
+enum class RecordFormat {
+    Csv,            // Comma separated values, with a header line
+    JsonLines       // One JSON object per line
+};
+
+/*!
+ * \brief The kinds of results written as records.
+ */
+struct ResultFields {
+    bool meshes = true;                 // true to write the current of each mesh
+    bool branches = true;               // true to write the current of each branch
+    bool elements = true;               // true to write the power dissipated by each resistance
+};
+
+/*!
+* \brief Function that writes the results of a packed circuit as one record per line.
+* 
+* Each record has the kind of item (mesh, branch or element), its ID, the quantity
+* (current or power) and its value, and they are written as they are computed, so
+* the whole document is never held in memory. A CSV record is kind,ID,quantity,value
+* after a header line with those names, and a JSON record is an object with the keys
+* "kind", "ID" and the quantity.
+* 
+* \param t_circuit The packed circuit
+* \param t_results The view of the results of the circuit
+* \param t_probes The requested meshes, branches and elements, or nullptr to write every
+* mesh, branch and resistance
+* \param t_fields The kinds of results to write
+* \param t_format The format of the records
+* \param t_writer The writer of the output, which is closed at the end
+* 
+* \return true if the records were written, false otherwise
+*/
+bool saveRecords(const CircuitView &t_circuit, ResultsView &t_results, const Probes *t_probes,
+    const ResultFields &t_fields, RecordFormat t_format, ResultsWriter &t_writer);
+
+/*!
+* \brief Function that returns the size of the mesh system of a circuit, without building it.
+* 
+* \param t_circuit The packed circuit
+* 
+* \return The size of the system
+*/
+SystemSize meshSystemSize(const CircuitView &t_circuit);
+
+/*!
+* \brief Function that chooses the method used to solve a circuit.
+* 
+* Only circuits with nodes, given as a netlist, can be solved with nodal analysis.
+* When the method is chosen automatically, the system with the fewest non-zero
+* elements is taken, and the one with the fewest unknowns if both have as many.
+* 
+* \param t_circuit The packed circuit
+* \param t_requested The method requested
+* 
+* \return The method used, Mesh or Nodal
+*/
+SolverEngine chooseEngine(const CircuitView &t_circuit, SolverEngine t_requested);
+
+/*!
+* \brief Function that builds and solves the equations system of the circuit of a context.
+* 
+* The system is built with the method chosen by chooseEngine for the engine of the context.
+* If the results of the context are deferred, only the mesh currents are computed, and
+* the branch currents if nodal analysis gives them anyway.
+* 
+* \param t_context The context, whose system and results are filled
+* 
+* \return true if the circuit was solved, false if its impedance matrix is singular
+*/
+bool solveCircuit(CircuitContext &t_context);
+
+/*!
+* \brief Function that save the results of a packed circuit into a text file.
+* 
+* The file is written through a ResultsWriter, and the numbers are written with the
+* shortest text that reads back as the same value. The meshes and branches of large
+* circuits are formatted by several threads, in chunks written in order.
+* 
+* \param t_circuit The packed circuit
+* \param t_results The results of the circuit
 * \param t_fileName The name of the file where the results are written on
+* 
+* \return true if the file was written, false otherwise
 */
-void saveToFile(std::vector<Mesh> &t_meshesVector, std::vector<Branch> &t_branchesVector,
-     std::string &t_fileName);
+bool saveToFile(const CircuitView &t_circuit, CircuitResults &t_results, std::string &t_fileName);
 
+/*!
+* \brief Function that save some of the results of a packed circuit into a text file.
+* 
+* Only the results of the requested meshes, branches and elements are computed and
+* written, in the same format as saveToFile.
+* 
+* \param t_circuit The packed circuit
+* \param t_results The view of the results of the circuit
+* \param t_probes The requested meshes, branches and elements
+* \param t_fileName The name of the file where the results are written on
+* 
+* \return true if the file was written, false otherwise
+*/
+bool saveProbesToFile(const CircuitView &t_circuit, ResultsView &t_results, const Probes &t_probes,
+    std::string &t_fileName);
 
+/*!
+ * \brief How the results of a circuit are written.
+ */
+struct ResultsOptions {
+    std::string format = "text";        // text, binary, csv or jsonl
+    ResultFields fields;                // The kinds of results written as records
+    std::vector<std::string> probeIDs;  // The IDs whose results are written, or empty to write them all
+};
 
+/*!
+* \brief Function that saves the results of a solved context.
+* 
+* The results are written in the format of the options. If the results of the context
+* are deferred, only the probes of the options are written, and a warning is written
+* for each probe that is not in the circuit.
+* 
+* \param t_context The solved context
+* \param t_options The format and the results to write
+* \param t_fileName The name of the results file
+* \param t_output The buffer the records are written to instead of the file, or nullptr
+* 
+* \return true if the results were written, false otherwise
+*/
+bool saveResults(CircuitContext &t_context, const ResultsOptions &t_options, std::string &t_fileName,
+    std::streambuf *t_output = nullptr);
+
+/*!
+* \brief Function that returns the default name of the results file of a circuit file.
+* 
+* \param t_inputFile The name of the circuit file
+* \param t_format The format of the results: text, binary, csv or jsonl
+* 
+* \return The name of the circuit file without its extension, followed by _solved and
+* the extension of the format
+*/
+std::string resultsFileName(const std::string &t_inputFile, const std::string &t_format);
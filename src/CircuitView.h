@@ -0,0 +1,106 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file CircuitView.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the packed, read-only representation
+ * of a circuit: every mesh, branch and element is stored in flat arrays that
+ * can point either to memory owned by the program or to a mapped file.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+/*!
+ * \brief The kind of a circuit element.
+ */
+enum class ElementKind : uint8_t {
+    Resistance = 0,     // A resistance, its value is given in ohms (Ω)
+    Battery = 1         // A battery, its value is given in volts (V)
+};
+
+/*!
+ * \brief A packed circuit.
+ *
+ * An struct which points to the arrays that describe a circuit. It does not own
+ * the arrays, so it is cheap to copy and it can be built on top of a mapped file.
+ *
+ * The mesh-branch incidence is stored in CSR form: the branches of the mesh i are
+ * meshBranchIndices[meshBranchOffsets[i]] ... meshBranchIndices[meshBranchOffsets[i + 1] - 1],
+ * and meshBranchSigns tells whether the mesh current flows in the same (+1) or in the
+ * opposite (-1) direction as the branch current.
+ * The elements of each branch are stored contiguously in the same way.
+ *
+ * Circuits given as a netlist also keep the nodes each branch connects. Their meshes
+ * are the loops found by findLoops, so the first branch of each mesh is only traversed
+ * by that mesh and the ones after it. Circuits given by their meshes have no nodes.
+ */
+struct CircuitView {
+    // Interned identifiers
+    uint32_t stringCount = 0;                       // The number of interned strings
+    const uint32_t *stringOffsets = nullptr;        // stringCount + 1 offsets into stringData
+    const char *stringData = nullptr;               // The characters of all the strings
+
+    // Meshes
+    uint32_t meshCount = 0;                         // The number of meshes
+    const uint32_t *meshIDs = nullptr;              // The string index of each mesh ID
+    const uint32_t *meshBranchOffsets = nullptr;    // meshCount + 1 offsets into the incidence arrays
+    const uint32_t *meshBranchIndices = nullptr;    // The branch index of each incidence entry
+    const int8_t *meshBranchSigns = nullptr;        // The orientation of each incidence entry (+1 or -1)
+
+    // Branches
+    uint32_t branchCount = 0;                       // The number of branches
+    const uint32_t *branchIDs = nullptr;            // The string index of each branch ID
+    const uint32_t *branchElementOffsets = nullptr; // branchCount + 1 offsets into the element arrays
+
+    // Elements
+    uint32_t elementCount = 0;                      // The number of elements
+    const uint32_t *elementIDs = nullptr;           // The string index of each element ID
+    const ElementKind *elementKinds = nullptr;      // The kind of each element
+    const double *elementValues = nullptr;          // The value of each element (Ω or V)
+
+    // Nodes
+    uint32_t nodeCount = 0;                         // The number of nodes, 0 if they are not known
+    const uint32_t *nodeIDs = nullptr;              // The string index of each node ID
+    const uint32_t *branchNodes = nullptr;          // The from and to nodes of each branch, 2 x branchCount
+
+    /*!
+    * \brief Function that returns an interned string.
+    *
+    * \param t_index The index of the string in the string table
+    *
+    * \return The string
+    */
+    std::string_view string(uint32_t t_index) const {
+        return std::string_view(stringData + stringOffsets[t_index],
+            stringOffsets[t_index + 1] - stringOffsets[t_index]);
+    }
+
+    /*!
+    * \brief Function that returns the number of mesh-branch incidence entries.
+    *
+    * \return The number of incidence entries
+    */
+    uint32_t incidenceCount() const {
+        return meshCount == 0 ? 0 : meshBranchOffsets[meshCount];
+    }
+};
@@ -0,0 +1,38 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file FileSections.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to write and
+ * check the sections of the binary circuit and results files.
+ */
+
+#include "FileSections.h"
+
+using namespace std;
+
+
+uint64_t writeSection(ofstream &file, const void *data, size_t size) {
+    static const char padding[SECTION_ALIGNMENT] = {};
+
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(static_cast<const char *>(data), size);
+    file.write(padding, (SECTION_ALIGNMENT - size % SECTION_ALIGNMENT) % SECTION_ALIGNMENT);
+    return position;
+}
@@ -0,0 +1,59 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file FileSections.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to write and check
+ * the sections of the binary circuit and results files.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+
+// Alignment of every section in a binary file (bytes)
+const uint64_t SECTION_ALIGNMENT = 8;
+
+/*!
+* \brief Function that writes a section, padded to SECTION_ALIGNMENT.
+*
+* \param t_file The binary file
+* \param t_data The data of the section
+* \param t_size The size of the section (bytes)
+*
+* \return The position of the section in the file
+*/
+uint64_t writeSection(std::ofstream &t_file, const void *t_data, size_t t_size);
+
+/*!
+* \brief Function that checks that a section fits in the file and is aligned.
+*
+* \param t_header The header of the file, with the position of each section in sectionOffsets
+* \param t_section The section
+* \param t_size The size of the section (bytes)
+* \param t_fileSize The size of the file (bytes)
+*
+* \return true if the section is valid, false otherwise
+*/
+template <typename Header>
+bool checkSection(const Header &t_header, unsigned t_section, uint64_t t_size, size_t t_fileSize) {
+    uint64_t offset = t_header.sectionOffsets[t_section];
+    return offset % SECTION_ALIGNMENT == 0 && offset <= t_fileSize && t_size <= t_fileSize - offset;
+}
@@ -23,6 +23,8 @@ limitations under the License.
  * to solve the system of linear equations which defines the Ohm's law (V = I x R)
  */
 
+#include <algorithm>
+#include <cmath>
 #include "LinearSystemSolver.h"
 
 using namespace std;
@@ -109,4 +111,417 @@ vector<double> solveSystem(vector<vector<double>> &impedanceMatrix, vector<doubl
         currents[i] = (Y[i] + substract) / L_U.U[i][i];
     }
     return currents;
-}
\ No newline at end of file
+}
+namespace {
+
+    // Relative size that the diagonal must have to be preferred as pivot
+    const double PIVOT_TOLERANCE = 0.001;
+
+    // Fraction of the non-zeros of L and U that a sparse solve may visit before it is
+    // done as a dense one, since it would cost more than the dense one then
+    const double SPARSE_SOLVE_BUDGET = 0.25;
+
+    /*!
+    * \brief Function that sizes a workspace for a matrix of dimension dim, clearing it
+    * only if its size changes.
+    */
+    void prepareWorkspace(SolveWorkspace &workspace, int dim) {
+        if (static_cast<int>(workspace.x.size()) != dim) {
+            workspace.x.assign(dim, 0.0);
+            workspace.xi.resize(dim);
+            workspace.stack.resize(dim);
+            workspace.positions.resize(dim);
+            workspace.marked.assign(dim, 0);
+        }
+    }
+
+    /*!
+    * \brief Function that finds the non-zero pattern of the solution of G x X = B, where
+    * G is a triangular matrix and B has the non-zero rows rows[0] ... rows[count - 1].
+    *
+    * The pattern is the set of rows reachable from the non-zeros of B in the graph of G,
+    * found with a depth first search. The rows are stored in xi[top] ... xi[dim - 1] in
+    * topological order, so G can be applied column by column in that order.
+    * The row j of G is its column pivots[j], or j if there are no pivots, and columns
+    * that are not computed yet (pivots[j] < 0) have no outgoing edges.
+    * If budget is given, the search gives up after visiting that many edges, which
+    * are subtracted from it.
+    *
+    * \return top, or -1 if the search gave up
+    */
+    int reach(const SparseMatrix &G, const int *rows, int count, const int *pivots,
+        vector<int> &xi, vector<int> &stack, vector<int> &positions, vector<char> &marked,
+        size_t *budget = nullptr) {
+
+        int top = G.dim;
+        for (int p = 0; p < count; p++) {
+            if (marked[rows[p]])
+                continue;
+            // Non-recursive depth first search from this row
+            int head = 0;
+            stack[0] = rows[p];
+            while (head >= 0) {
+                int j = stack[head];
+                int column = pivots == nullptr ? j : pivots[j];
+                if (!marked[j]) {
+                    marked[j] = 1;
+                    positions[head] = column < 0 ? 0 : G.columnOffsets[column];
+                }
+                bool done = true;
+                int end = column < 0 ? 0 : G.columnOffsets[column + 1];
+                int start = positions[head];
+                for (int q = start; q < end; q++) {
+                    int i = G.rowIndices[q];
+                    if (marked[i])
+                        continue;
+                    // Go deeper, and come back to the next edge of j later
+                    positions[head] = q + 1;
+                    stack[++head] = i;
+                    done = false;
+                    break;
+                }
+                if (budget != nullptr) {
+                    size_t edges = static_cast<size_t>((done ? end : positions[head - 1]) - start);
+                    if (edges > *budget) {
+                        // Give up, clearing the marks of the rows visited so far
+                        for (int p = top; p < G.dim; p++)
+                            marked[xi[p]] = 0;
+                        for (int p = 0; p <= head; p++)
+                            marked[stack[p]] = 0;
+                        return -1;
+                    }
+                    *budget -= edges;
+                }
+                if (done) {
+                    // All the rows reachable from j have been found
+                    head--;
+                    xi[--top] = j;
+                }
+            }
+        }
+        // Clear the marks for the next search
+        for (int p = top; p < G.dim; p++)
+            marked[xi[p]] = 0;
+        return top;
+    }
+
+    /*!
+    * \brief Function that computes the columns first ... dim - 1 of an LU decomposition.
+    *
+    * The columns before first must be computed already, with the rows of L not referred
+    * to the pivoted order yet, and the rows not pivoted yet must have pivots[i] < 0.
+    * The workspace of the sparse triangular solves is left clean.
+    */
+    void factorColumns(SparseMatrix &matrix, SparseLU &lu, int first, SolveWorkspace &workspace) {
+
+        int dim = matrix.dim;
+        lu.singular = false;
+        lu.L.columnOffsets.resize(dim + 1);
+        lu.U.columnOffsets.resize(dim + 1);
+
+        prepareWorkspace(workspace, dim);
+        vector<double> &x = workspace.x;
+        vector<int> &xi = workspace.xi;
+        vector<int> &stack = workspace.stack;
+        vector<int> &positions = workspace.positions;
+        vector<char> &marked = workspace.marked;
+
+        for (int k = first; k < dim; k++) {
+            lu.L.columnOffsets[k] = lu.L.rowIndices.size();
+            lu.U.columnOffsets[k] = lu.U.rowIndices.size();
+
+            // Solve L x X = A(:, k), only for the rows in the non-zero pattern of X
+            int top = reach(lu.L, matrix.rowIndices.data() + matrix.columnOffsets[k],
+                matrix.columnOffsets[k + 1] - matrix.columnOffsets[k], lu.pivots.data(),
+                xi, stack, positions, marked);
+            for (int p = top; p < dim; p++)
+                x[xi[p]] = 0.0;
+            for (int p = matrix.columnOffsets[k]; p < matrix.columnOffsets[k + 1]; p++)
+                x[matrix.rowIndices[p]] += matrix.values[p];
+            for (int p = top; p < dim; p++) {
+                int j = xi[p];
+                int column = lu.pivots[j];
+                if (column < 0)
+                    continue;
+                // The unit diagonal of L is the first element of the column
+                for (int q = lu.L.columnOffsets[column] + 1; q < lu.L.columnOffsets[column + 1]; q++)
+                    x[lu.L.rowIndices[q]] -= lu.L.values[q] * x[j];
+            }
+
+            // Rows already pivoted go to U, the largest of the others is the pivot
+            int pivot_row = -1;
+            double largest = -1.0;
+            for (int p = top; p < dim; p++) {
+                int i = xi[p];
+                if (lu.pivots[i] < 0) {
+                    if (fabs(x[i]) > largest) {
+                        largest = fabs(x[i]);
+                        pivot_row = i;
+                    }
+                } else {
+                    lu.U.rowIndices.push_back(lu.pivots[i]);
+                    lu.U.values.push_back(x[i]);
+                }
+            }
+            if (pivot_row == -1 || largest <= 0.0) {
+                for (int p = top; p < dim; p++)
+                    x[xi[p]] = 0.0;
+                lu.singular = true;
+                return;
+            }
+            // Prefer the diagonal if it is large enough
+            if (lu.pivots[k] < 0 && fabs(x[k]) >= PIVOT_TOLERANCE * largest)
+                pivot_row = k;
+
+            // The pivot is the last element of the column of U
+            double pivot = x[pivot_row];
+            lu.U.rowIndices.push_back(k);
+            lu.U.values.push_back(pivot);
+            lu.pivots[pivot_row] = k;
+            // The unit diagonal is the first element of the column of L
+            lu.L.rowIndices.push_back(pivot_row);
+            lu.L.values.push_back(1.0);
+            for (int p = top; p < dim; p++) {
+                int i = xi[p];
+                if (lu.pivots[i] < 0) {
+                    lu.L.rowIndices.push_back(i);
+                    lu.L.values.push_back(x[i] / pivot);
+                }
+                x[i] = 0.0;
+            }
+        }
+        lu.L.columnOffsets[dim] = lu.L.rowIndices.size();
+        lu.U.columnOffsets[dim] = lu.U.rowIndices.size();
+
+        // Refer the rows of L to the pivoted order
+        for (auto &row : lu.L.rowIndices)
+            row = lu.pivots[row];
+    }
+
+}
+
+
+SparseLU LUdecomposition(SparseMatrix &matrix) {
+    /* Gilbert-Peierls Algorithm */
+
+    int dim = matrix.dim;
+    SparseLU lu;
+    lu.L.dim = dim;
+    lu.U.dim = dim;
+    lu.pivots.assign(dim, -1);
+    SolveWorkspace workspace;
+    factorColumns(matrix, lu, 0, workspace);
+    return lu;
+}
+
+
+void LUrefactor(SparseMatrix &matrix, SparseLU &lu, int firstColumn, SolveWorkspace &workspace) {
+    int dim = matrix.dim;
+    if (firstColumn >= dim && !lu.singular && lu.L.dim == dim)
+        return;
+    if (firstColumn <= 0 || lu.singular || lu.L.dim != dim) {
+        // Factorize every column again, into the arrays of the previous decomposition
+        lu.L.dim = dim;
+        lu.U.dim = dim;
+        lu.L.rowIndices.clear();
+        lu.L.values.clear();
+        lu.U.rowIndices.clear();
+        lu.U.values.clear();
+        lu.pivots.assign(dim, -1);
+        factorColumns(matrix, lu, 0, workspace);
+        return;
+    }
+
+    // Keep the columns before firstColumn, with the rows of L back in the original
+    // order, and forget the pivots of the other columns. The positions of the
+    // workspace hold the original row of each pivoted row until the columns are
+    // factorized
+    prepareWorkspace(workspace, dim);
+    vector<int> &rows = workspace.positions;
+    for (int i = 0; i < dim; i++)
+        rows[lu.pivots[i]] = i;
+    lu.L.rowIndices.resize(lu.L.columnOffsets[firstColumn]);
+    lu.L.values.resize(lu.L.columnOffsets[firstColumn]);
+    lu.U.rowIndices.resize(lu.U.columnOffsets[firstColumn]);
+    lu.U.values.resize(lu.U.columnOffsets[firstColumn]);
+    for (auto &row : lu.L.rowIndices)
+        row = rows[row];
+    for (int i = 0; i < dim; i++) {
+        if (lu.pivots[i] >= firstColumn)
+            lu.pivots[i] = -1;
+    }
+    factorColumns(matrix, lu, firstColumn, workspace);
+}
+
+
+vector<double> solveLU(const SparseLU &lu, const vector<double> &voltages) {
+    vector<double> currents;
+    solveLU(lu, voltages, currents);
+    return currents;
+}
+
+
+void solveLU(const SparseLU &lu, const vector<double> &voltages, vector<double> &currents) {
+
+    // Solve the system L x Y = P x voltages, where L is the lower diagonal matrix
+    int dim = lu.L.dim;
+    currents.resize(dim);
+    for (int i = 0; i < dim; i++)
+        currents[lu.pivots[i]] = voltages[i];
+    for (int j = 0; j < dim; j++) {
+        for (int p = lu.L.columnOffsets[j] + 1; p < lu.L.columnOffsets[j + 1]; p++)
+            currents[lu.L.rowIndices[p]] -= lu.L.values[p] * currents[j];
+    }
+
+    // Solve the system U x currents = Y, where U is the upper diagonal matrix
+    for (int j = dim - 1; j >= 0; j--) {
+        currents[j] /= lu.U.values[lu.U.columnOffsets[j + 1] - 1];
+        for (int p = lu.U.columnOffsets[j]; p < lu.U.columnOffsets[j + 1] - 1; p++)
+            currents[lu.U.rowIndices[p]] -= lu.U.values[p] * currents[j];
+    }
+}
+
+
+namespace {
+
+    /*!
+    * \brief Function that solves a sparse system whose right-hand side is sparse with a
+    * dense solve, when its solution is not sparse enough.
+    *
+    * The elements of the workspace in the pattern of the right-hand side or in
+    * workspace.pattern are cleared first.
+    */
+    SparseVector solveLUDense(const SparseLU &lu, const SparseVector &rhs, SolveWorkspace &workspace) {
+        for (int row : workspace.pattern)
+            workspace.x[row] = 0.0;
+        for (int i : rhs.indices)
+            workspace.x[lu.pivots[i]] = 0.0;
+
+        vector<double> voltages(lu.L.dim, 0.0);
+        for (size_t p = 0; p < rhs.indices.size(); p++)
+            voltages[rhs.indices[p]] += rhs.values[p];
+        vector<double> currents = solveLU(lu, voltages);
+        SparseVector solution;
+        for (int i = 0; i < lu.L.dim; i++) {
+            if (currents[i] != 0.0) {
+                solution.indices.push_back(i);
+                solution.values.push_back(currents[i]);
+            }
+        }
+        return solution;
+    }
+
+}
+
+
+SparseVector solveLUSparse(const SparseLU &lu, const SparseVector &rhs, SolveWorkspace &workspace) {
+    int dim = lu.L.dim;
+    prepareWorkspace(workspace, dim);
+    vector<double> &x = workspace.x;
+    vector<int> &xi = workspace.xi;
+
+    // Solve the system L x Y = P x rhs, only for the rows reachable from the
+    // non-zeros of the permuted right-hand side in the graph of L
+    size_t budget = static_cast<size_t>(SPARSE_SOLVE_BUDGET * (lu.L.rowIndices.size() + lu.U.rowIndices.size()));
+    vector<int> &pattern = workspace.pattern;
+    pattern.clear();
+    for (size_t p = 0; p < rhs.indices.size(); p++) {
+        int row = lu.pivots[rhs.indices[p]];
+        pattern.push_back(row);
+        x[row] += rhs.values[p];
+    }
+    int top = reach(lu.L, pattern.data(), static_cast<int>(pattern.size()), nullptr, xi,
+        workspace.stack, workspace.positions, workspace.marked, &budget);
+    if (top < 0)
+        return solveLUDense(lu, rhs, workspace);
+    for (int p = top; p < dim; p++) {
+        int j = xi[p];
+        for (int q = lu.L.columnOffsets[j] + 1; q < lu.L.columnOffsets[j + 1]; q++)
+            x[lu.L.rowIndices[q]] -= lu.L.values[q] * x[j];
+    }
+
+    // Solve the system U x X = Y, only for the rows reachable from the pattern of Y
+    // in the graph of U, which includes that pattern
+    pattern.assign(xi.begin() + top, xi.end());
+    top = reach(lu.U, pattern.data(), static_cast<int>(pattern.size()), nullptr, xi,
+        workspace.stack, workspace.positions, workspace.marked, &budget);
+    if (top < 0)
+        return solveLUDense(lu, rhs, workspace);
+    for (int p = top; p < dim; p++) {
+        int j = xi[p];
+        x[j] /= lu.U.values[lu.U.columnOffsets[j + 1] - 1];
+        for (int q = lu.U.columnOffsets[j]; q < lu.U.columnOffsets[j + 1] - 1; q++)
+            x[lu.U.rowIndices[q]] -= lu.U.values[q] * x[j];
+    }
+
+    // Gather the solution and leave the workspace clean
+    SparseVector solution;
+    solution.indices.reserve(dim - top);
+    solution.values.reserve(dim - top);
+    for (int p = top; p < dim; p++) {
+        solution.indices.push_back(xi[p]);
+        solution.values.push_back(x[xi[p]]);
+        x[xi[p]] = 0.0;
+    }
+    return solution;
+}
+
+
+vector<double> solveLUEntries(const SparseLU &lu, const vector<double> &rhs, const vector<int> &entries,
+    SolveWorkspace &workspace) {
+    vector<double> solution;
+    solution.reserve(entries.size());
+    SparseVector unit;
+    unit.values.push_back(1.0);
+    for (int i : entries) {
+        // The column i of the inverse is also its row i
+        unit.indices.assign(1, i);
+        SparseVector column = solveLUSparse(lu, unit, workspace);
+        double value = 0.0;
+        for (size_t p = 0; p < column.indices.size(); p++)
+            value += column.values[p] * rhs[column.indices[p]];
+        solution.push_back(value);
+    }
+    return solution;
+}
+
+
+void addToElement(SparseMatrix &matrix, int row, int column, double value) {
+    auto first = matrix.rowIndices.begin() + matrix.columnOffsets[column];
+    auto last = matrix.rowIndices.begin() + matrix.columnOffsets[column + 1];
+    auto found = lower_bound(first, last, row);
+    size_t position = found - matrix.rowIndices.begin();
+    if (found != last && *found == row) {
+        matrix.values[position] += value;
+        return;
+    }
+
+    // Insert the element, which moves the columns after it
+    matrix.rowIndices.insert(found, row);
+    matrix.values.insert(matrix.values.begin() + position, value);
+    for (int j = column + 1; j <= matrix.dim; j++)
+        matrix.columnOffsets[j]++;
+}
+
+void setElement(SparseMatrix &matrix, int row, int column, double value) {
+    auto first = matrix.rowIndices.begin() + matrix.columnOffsets[column];
+    auto last = matrix.rowIndices.begin() + matrix.columnOffsets[column + 1];
+    auto found = lower_bound(first, last, row);
+    if (found != last && *found == row) {
+        matrix.values[found - matrix.rowIndices.begin()] = value;
+        return;
+    }
+    if (value != 0.0)
+        addToElement(matrix, row, column, value);
+}
+
+vector<double> solveSystem(SparseMatrix &impedanceMatrix, vector<double> &voltages) {
+
+    // Calculate the LU decomposition of the impedanceMatrix
+    SparseLU L_U = LUdecomposition(impedanceMatrix);
+    if (L_U.singular)
+        return {};
+
+    // Solve the system with the decomposition
+    return solveLU(L_U, voltages);
+}
@@ -64,3 +64,189 @@ LU LUdecomposition(std::vector<std::vector<double>> &t_Matrix);
 */
 std::vector<double> solveSystem(std::vector<std::vector<double>> &t_impedanceMatrix,
     std::vector<double> &t_voltages);
+
+
+/*!
+ * \brief A sparse square matrix.
+ *
+ * An struct which stores a square matrix in compressed column form: the non-zero
+ * elements of the column j are values[columnOffsets[j]] ... values[columnOffsets[j + 1] - 1],
+ * and rowIndices holds the row of each of them.
+ */
+struct SparseMatrix {
+    int dim = 0;                        // The number of rows and columns
+    std::vector<int> columnOffsets;     // dim + 1 offsets into rowIndices and values
+    std::vector<int> rowIndices;        // The row of each non-zero element
+    std::vector<double> values;         // The value of each non-zero element
+};
+
+/*!
+ * \brief The LU decomposition of a sparse square matrix.
+ *
+ * An struct which defines the two sparse matrices of the decomposition P x A = L x U,
+ * where P is the row permutation given by the partial pivoting:
+ * L is the lower triangular matrix, with a unit diagonal stored first in each column
+ * U is the upper triangular matrix, with the diagonal stored last in each column
+ */
+struct SparseLU {
+    SparseMatrix L;             // The lower triangular matrix
+    SparseMatrix U;             // The upper triangular matrix
+    std::vector<int> pivots;    // The row i of the matrix is the row pivots[i] of L x U
+    bool singular = false;      // true if the matrix is singular, L and U are not valid then
+};
+
+/*!
+* \brief Function that returns the LU decomposition of a sparse square matrix.
+* 
+* It uses the left-looking Gilbert-Peierls algorithm: each column of L and U is
+* obtained by a sparse triangular solve whose non-zero pattern is found with a depth
+* first search in the graph of L, so the cost is proportional to the number of
+* floating point operations. The diagonal is chosen as pivot whenever it is not much
+* smaller than the largest candidate, which keeps the pattern of symmetric matrices.
+* 
+* \param t_Matrix The input sparse square matrix
+* 
+* \return the sparse LU decomposition struct (L and U matrices and row pivots)
+*/
+SparseLU LUdecomposition(SparseMatrix &t_Matrix);
+
+/*!
+ * \brief The workspace of the sparse solves.
+ *
+ * An struct which holds the arrays used by solveLUSparse and LUrefactor. They are
+ * allocated by the first solve and left clean after each one, so a workspace reused
+ * by several solves makes their cost independent of the size of the matrix, and a
+ * workspace reused by several refactorizations doesn't allocate them again.
+ */
+struct SolveWorkspace {
+    std::vector<double> x;              // The dense solution, zero outside a solve
+    std::vector<int> xi;                // The non-zero pattern of the solution
+    std::vector<int> stack;             // The stack of the depth first search
+    std::vector<int> positions;         // The next edge of each row of the stack
+    std::vector<int> pattern;           // A copy of the pattern of the forward solve
+    std::vector<char> marked;           // The rows visited by the search, zero outside a solve
+};
+
+/*!
+* \brief Function that updates the LU decomposition of a sparse matrix whose columns
+* from t_firstColumn on have changed.
+* 
+* The columns of L and U before t_firstColumn, and their pivots, only depend on the
+* columns of the matrix before it, so they are kept and the factorization goes on
+* from t_firstColumn. For a symmetric matrix, a change in the row and column i only
+* requires t_firstColumn <= i. Singular or outdated decompositions are computed again
+* from scratch. The new columns are written into the arrays of the old decomposition,
+* so a refactorization of a matrix whose pattern doesn't change doesn't allocate.
+* 
+* \param t_Matrix The sparse square matrix, with its new values
+* \param t_lu The decomposition of the matrix before it changed, which is updated
+* \param t_firstColumn The first column of the matrix that has changed
+* \param t_workspace The workspace of the sparse triangular solves
+*/
+void LUrefactor(SparseMatrix &t_Matrix, SparseLU &t_lu, int t_firstColumn, SolveWorkspace &t_workspace);
+
+/*!
+* \brief Function that solves a sparse system with the LU decomposition of its matrix.
+* 
+* \param t_lu The decomposition of the matrix, which must not be singular
+* \param t_voltages The right-hand side of the system
+* 
+* \return the solution of the system
+*/
+std::vector<double> solveLU(const SparseLU &t_lu, const std::vector<double> &t_voltages);
+
+/*!
+* \brief Function that solves a sparse system with the LU decomposition of its matrix,
+* into a vector of the caller.
+* 
+* \param t_lu The decomposition of the matrix, which must not be singular
+* \param t_voltages The right-hand side of the system
+* \param t_currents The solution of the system, resized if needed
+*/
+void solveLU(const SparseLU &t_lu, const std::vector<double> &t_voltages, std::vector<double> &t_currents);
+
+/*!
+ * \brief A sparse vector.
+ *
+ * An struct which holds the non-zero elements of a vector, in any order.
+ */
+struct SparseVector {
+    std::vector<int> indices;           // The index of each non-zero element
+    std::vector<double> values;         // The value of each non-zero element
+};
+
+/*!
+* \brief Function that solves a sparse system whose right-hand side is sparse.
+* 
+* The non-zero pattern of the solution is found from the right-hand side in the graphs
+* of L and U, as in the Gilbert-Peierls algorithm, and only the columns of L and U in
+* that pattern are applied. The cost is proportional to the number of floating point
+* operations, so a local change of the right-hand side only costs as much as the
+* region of the solution that it changes. When the search of the pattern visits a
+* large part of L and U, the system is solved as a dense one instead.
+* 
+* \param t_lu The decomposition of the matrix, which must not be singular
+* \param t_rhs The right-hand side of the system, repeated indices are added up
+* \param t_workspace The workspace of the solve
+* 
+* \return the non-zero elements of the solution, in no particular order
+*/
+SparseVector solveLUSparse(const SparseLU &t_lu, const SparseVector &t_rhs, SolveWorkspace &t_workspace);
+
+/*!
+* \brief Function that computes some elements of the solution of a sparse symmetric system.
+* 
+* As the matrix A is symmetric, the element i of the solution is the product of the
+* right-hand side by the column i of the inverse of A, which is found with a sparse
+* solve. Only the elements of the right-hand side in the pattern of that column are
+* read, so the cost does not depend on the size of the system.
+* 
+* \param t_lu The decomposition of the symmetric matrix, which must not be singular
+* \param t_rhs The right-hand side of the system
+* \param t_entries The index of each element of the solution to compute
+* \param t_workspace The workspace of the solves
+* 
+* \return the requested elements of the solution, in the order of t_entries
+*/
+std::vector<double> solveLUEntries(const SparseLU &t_lu, const std::vector<double> &t_rhs,
+    const std::vector<int> &t_entries, SolveWorkspace &t_workspace);
+
+/*!
+* \brief Function that adds a value to an element of a sparse matrix.
+* 
+* The element is inserted if it is not stored yet, which moves every element after it.
+* The rows of each column must be sorted, and they are kept sorted.
+* 
+* \param t_Matrix The sparse square matrix
+* \param t_row The row of the element
+* \param t_column The column of the element
+* \param t_value The value to add
+*/
+void addToElement(SparseMatrix &t_Matrix, int t_row, int t_column, double t_value);
+
+/*!
+* \brief Function that sets an element of a sparse matrix.
+* 
+* The element is inserted if it is not stored yet and the value is not zero, which
+* moves every element after it. The rows of each column must be sorted, and they are
+* kept sorted.
+* 
+* \param t_Matrix The sparse square matrix
+* \param t_row The row of the element
+* \param t_column The column of the element
+* \param t_value The new value
+*/
+void setElement(SparseMatrix &t_Matrix, int t_row, int t_column, double t_value);
+
+/*!
+* \brief Function that returns the mesh currents vector of a sparse system.
+* 
+* It solves the V = I x R system of linear equations by calling the sparse LU
+* decomposition function of the R matrix.
+* 
+* \param t_impedanceMatrix The circuit impedance matrix, R
+* \param t_voltages The circuit voltages, V
+
+* \return the resulting currents vector, empty if R is singular
+*/
+std::vector<double> solveSystem(SparseMatrix &t_impedanceMatrix, std::vector<double> &t_voltages);
@@ -0,0 +1,189 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Log.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to write the
+ * messages of the program to the console without waiting for it.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Log.h"
+
+using namespace std;
+
+// Number of slots of the ring buffer of messages, a power of two
+const size_t LOG_SLOT_COUNT = 4096;
+
+// Number of characters of a message held by each slot, longer messages take several slots
+const size_t LOG_SLOT_SIZE = 120;
+
+namespace {
+
+    atomic<LogLevel> level(LogLevel::Info);     // The most detailed level written
+
+    /*!
+    * \brief A part of a message in the ring buffer.
+    *
+    * The slot at position p of the sequence of slots can be filled when its
+    * sequence is p, and written to the console when it is p + 1.
+    */
+    struct LogSlot {
+        atomic<size_t> sequence;                // The position of the slot, as described above
+        size_t length;                          // The number of characters in text
+        char text[LOG_SLOT_SIZE];               // The characters of the part of the message
+    };
+
+    /*!
+    * \brief The ring buffer of messages and the thread that writes them.
+    *
+    * Any thread may add messages: it reserves the slots of its message with an atomic
+    * increment, so the parts of a message are consecutive, and fills them. The writer
+    * thread takes the slots in order and writes them to the standard output, flushing
+    * it whenever the buffer runs empty. Then it sleeps until a message is added, and
+    * only a thread that fills a slot while the writer sleeps takes the lock to wake it.
+    */
+    class LogQueue {
+
+        private:
+            LogSlot m_slots[LOG_SLOT_COUNT];    // The ring buffer
+            atomic<size_t> m_reserved;          // The position of the next slot to be reserved
+            atomic<size_t> m_written;           // The position of the first slot not written yet
+            atomic<bool> m_stopping;            // true when the program ends
+            atomic<bool> m_sleeping;            // true while the writer thread waits for a message
+            mutex m_lock;                       // Taken to sleep, or to wake a sleeping thread
+            condition_variable m_wake;          // Notified when a slot is filled or the program ends
+            condition_variable m_flushed;       // Notified when the buffer was written
+            thread m_writer;                    // The thread that writes the messages
+
+            /*!
+            * \brief Function run by the writer thread.
+            */
+            void run() {
+                size_t position = 0;
+                string pending;
+                while (true) {
+                    LogSlot &slot = m_slots[position % LOG_SLOT_COUNT];
+                    if (slot.sequence.load(memory_order_acquire) == position + 1) {
+                        pending.append(slot.text, slot.length);
+                        slot.sequence.store(position + LOG_SLOT_COUNT, memory_order_release);
+                        position++;
+                        continue;
+                    }
+
+                    // The buffer is empty, write what was taken from it
+                    if (!pending.empty()) {
+                        cout.write(pending.data(), pending.size());
+                        cout.flush();
+                        pending.clear();
+                    }
+                    m_written.store(position, memory_order_release);
+                    unique_lock<mutex> guard(m_lock);
+                    m_flushed.notify_all();
+                    if (m_stopping.load() && position == m_reserved.load())
+                        return;
+
+                    // Sleep until the next slot is filled. The flag is set before the slot
+                    // is checked, and a producer fills the slot before checking the flag, so
+                    // either the writer sees the slot or the producer sees the flag
+                    m_sleeping.store(true);
+                    m_wake.wait(guard, [&] { return slot.sequence.load() == position + 1 || m_stopping.load(); });
+                    m_sleeping.store(false, memory_order_relaxed);
+                }
+            }
+
+        public:
+            LogQueue() : m_reserved(0), m_written(0), m_stopping(false), m_sleeping(false) {
+                for (size_t i = 0; i < LOG_SLOT_COUNT; i++)
+                    m_slots[i].sequence.store(i, memory_order_relaxed);
+                m_writer = thread(&LogQueue::run, this);
+            }
+
+            ~LogQueue() {
+                {
+                    lock_guard<mutex> guard(m_lock);
+                    m_stopping.store(true);
+                }
+                m_wake.notify_one();
+                m_writer.join();
+            }
+
+            void push(string_view text) {
+                size_t count = max<size_t>(1, (text.size() + LOG_SLOT_SIZE - 1) / LOG_SLOT_SIZE);
+                size_t position = m_reserved.fetch_add(count, memory_order_relaxed);
+                for (size_t i = 0; i < count; i++, position++) {
+                    // Wait for the writer thread if the buffer is full
+                    LogSlot &slot = m_slots[position % LOG_SLOT_COUNT];
+                    while (slot.sequence.load(memory_order_acquire) != position)
+                        this_thread::yield();
+                    slot.length = min(LOG_SLOT_SIZE, text.size());
+                    memcpy(slot.text, text.data(), slot.length);
+                    text.remove_prefix(slot.length);
+                    slot.sequence.store(position + 1);
+
+                    // Wake the writer thread if it sleeps, which it may do for this slot
+                    if (m_sleeping.load()) {
+                        lock_guard<mutex> guard(m_lock);
+                        m_wake.notify_one();
+                    }
+                }
+            }
+
+            void flush() {
+                size_t reserved = m_reserved.load(memory_order_acquire);
+                unique_lock<mutex> guard(m_lock);
+                m_flushed.wait(guard, [&] { return m_written.load(memory_order_acquire) >= reserved; });
+            }
+    };
+
+    /*!
+    * \brief Function that returns the queue of messages, starting it the first time.
+    */
+    LogQueue &logQueue() {
+        static LogQueue queue;
+        return queue;
+    }
+}
+
+
+void setLogLevel(LogLevel t_level) {
+    level.store(t_level, memory_order_relaxed);
+}
+
+
+bool logEnabled(LogLevel t_level) {
+    return t_level <= level.load(memory_order_relaxed);
+}
+
+
+void writeLog(string_view text) {
+    logQueue().push(text);
+}
+
+
+void flushLog() {
+    logQueue().flush();
+}
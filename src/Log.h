@@ -0,0 +1,101 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Log.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to write the
+ * messages of the program to the console without waiting for it.
+ */
+
+#pragma once
+#include <sstream>
+#include <string_view>
+
+
+/*!
+* \brief The levels of detail of the messages.
+*
+* A message is written when its level is not above the level of the program. Errors
+* and warnings are always written, and Info, the default level, adds the steps of the
+* program. Verbose adds a message per mesh and branch read, and Trace adds a message
+* per element.
+*/
+enum class LogLevel {
+    Error,
+    Info,
+    Verbose,
+    Trace
+};
+
+/*!
+* \brief Function that sets the level of detail of the messages written.
+*
+* \param t_level The most detailed level written
+*/
+void setLogLevel(LogLevel t_level);
+
+/*!
+* \brief Function that tells if the messages of a level are written.
+*
+* \param t_level The level of the messages
+*
+* \return true if they are written
+*/
+bool logEnabled(LogLevel t_level);
+
+/*!
+* \brief Function that queues a text to be written to the console.
+*
+* The text is copied into a ring buffer that a background thread writes to the
+* standard output, so the caller does not wait for the console. It only waits if
+* the buffer is full.
+*
+* \param t_text The text, which usually ends in a new line
+*/
+void writeLog(std::string_view t_text);
+
+/*!
+* \brief Function that waits until every queued text is written to the console.
+*
+* It must be called before the program waits for the user, or before the standard
+* output is redirected.
+*/
+void flushLog();
+
+/*!
+* \brief Function that writes a message to the console, if its level is written.
+*
+* The arguments are formatted as if they were written to std::cout one after
+* another, and a new line is added after them.
+*
+* \param t_level The level of the message
+* \param t_args The parts of the message
+*/
+template <typename... Args>
+void logMessage(LogLevel t_level, const Args &... t_args) {
+    if (!logEnabled(t_level))
+        return;
+
+    // Every thread reuses its own stream to format its messages
+    static thread_local std::ostringstream stream;
+    stream.str(std::string());
+    stream.clear();
+    (stream << ... << t_args) << '\n';
+    writeLog(stream.str());
+}
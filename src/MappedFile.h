@@ -0,0 +1,107 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file MappedFile.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of a read-only memory mapped file.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+
+
+/*!
+ * \brief A read-only memory mapped file.
+ *
+ * A class that maps a whole file into memory. The mapping is released when
+ * the object is destroyed.
+ */
+class MappedFile {
+
+    private:
+        const char *m_data = nullptr;   // The first byte of the mapping
+        size_t m_size = 0;              // The size of the mapping (bytes)
+        std::string m_error = "";       // The description of the last error
+#ifdef _WIN32
+        void *m_file = nullptr;         // The file handle
+        void *m_mapping = nullptr;      // The file mapping handle
+#endif
+
+    public:
+        /*!
+        * \brief Default constructor.
+        *
+        * Creates an empty mapping.
+        */
+        MappedFile() = default;
+
+        /*!
+        * \brief Destructor.
+        *
+        * Releases the mapping.
+        */
+        ~MappedFile();
+
+        // A mapping can't be copied since it owns the mapped memory
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /*!
+        * \brief Function that maps a file into memory.
+        *
+        * \param t_fileName The name of the file to be mapped
+        *
+        * \return true if the file was mapped, false otherwise (see getError)
+        */
+        bool open(const std::string &t_fileName);
+
+        /*!
+        * \brief Function that releases the mapping.
+        */
+        void close();
+
+        /*!
+        * \brief Function that returns the first byte of the mapping.
+        *
+        * \return The mapped bytes
+        */
+        const char *data() const {
+            return m_data;
+        }
+
+        /*!
+        * \brief Function that returns the size of the mapping.
+        *
+        * \return The size of the mapping (bytes)
+        */
+        size_t size() const {
+            return m_size;
+        }
+
+        /*!
+        * \brief Function that returns the description of the last error.
+        *
+        * \return The error description
+        */
+        const std::string &getError() const {
+            return m_error;
+        }
+
+};
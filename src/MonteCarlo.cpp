@@ -0,0 +1,387 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file MonteCarlo.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to find how the
+ * tolerances of the elements of a circuit spread its branch currents.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "MonteCarlo.h"
+#include "CircuitEditor.h"
+#include "Log.h"
+#include "Parallel.h"
+#include "ValueParser.h"
+
+using namespace std;
+
+// Minimum number of samples solved by each thread
+const size_t MONTE_CARLO_SAMPLES_PER_THREAD = 16;
+
+// Largest relative error of the percentiles
+const double PERCENTILE_ACCURACY = 0.001;
+
+// Currents whose magnitude is below this value are counted as zero by the percentiles (A)
+const double PERCENTILE_ZERO = 1e-30;
+
+// Percentiles written for each branch
+const double PERCENTILES[] = {0.01, 0.05, 0.5, 0.95, 0.99};
+
+namespace {
+
+    const double LOG_GAMMA = log((1 + PERCENTILE_ACCURACY) / (1 - PERCENTILE_ACCURACY));
+    const double PI = 3.14159265358979323846;
+
+    /*!
+    * \brief Function that scrambles the bits of a number (the finalizer of SplitMix64).
+    */
+    uint64_t mixBits(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    /*!
+    * \brief Function that returns a random number in [0, 1) from a seed and two counters.
+    *
+    * The number only depends on its arguments, so any thread can draw the numbers of
+    * any sample, and they are the same whichever thread draws them.
+    */
+    double randomUniform(uint64_t seed, uint64_t sample, uint64_t stream) {
+        uint64_t bits = mixBits(mixBits(mixBits(seed) ^ sample) + 0x9e3779b97f4a7c15ULL * (stream + 1));
+        return static_cast<double>(bits >> 11) * 0x1.0p-53;
+    }
+
+    /*!
+    * \brief Function that returns the random value of an element in a sample.
+    */
+    double sampleValue(const Tolerance &tolerance, double nominal, uint64_t seed, uint64_t sample) {
+        double deviation = tolerance.relative ? tolerance.tolerance * abs(nominal) : tolerance.tolerance;
+        double u = randomUniform(seed, sample, 2 * static_cast<uint64_t>(tolerance.element));
+        if (tolerance.distribution == ToleranceDistribution::Uniform)
+            return nominal + deviation * (2 * u - 1);
+
+        // Box-Muller transform, with the tolerance at three standard deviations
+        double v = randomUniform(seed, sample, 2 * static_cast<uint64_t>(tolerance.element) + 1);
+        double normal = sqrt(-2 * log(1 - u)) * cos(2 * PI * v);
+        return nominal + deviation / 3 * normal;
+    }
+
+    /*!
+    * \brief Counts of values in bins whose bounds grow geometrically.
+    *
+    * The bin i holds the magnitudes in (γ^(i-1), γ^i], and only the range of bins
+    * between the smallest and the largest magnitude added is stored.
+    */
+    struct LogBins {
+        int offset = 0;                 // The index of the first bin stored
+        vector<uint64_t> counts;        // The count of each bin from the first
+
+        void add(int bin, uint64_t count) {
+            if (counts.empty()) {
+                offset = bin;
+            } else if (bin < offset) {
+                counts.insert(counts.begin(), offset - bin, 0);
+                offset = bin;
+            }
+            if (bin - offset >= static_cast<int>(counts.size()))
+                counts.resize(bin - offset + 1, 0);
+            counts[bin - offset] += count;
+        }
+    };
+
+    /*!
+    * \brief The statistics of the samples of a branch current.
+    *
+    * The mean and the variance are updated with Welford's method, and the percentiles
+    * are estimated from bins of relative width 2 x PERCENTILE_ACCURACY, one set for
+    * the positive currents and another for the negative ones. Two statistics can be
+    * merged, so each thread keeps its own.
+    */
+    struct CurrentStatistics {
+        uint64_t count = 0;             // The number of samples
+        double mean = 0;                // The mean of the samples
+        double squares = 0;             // The sum of the squared differences to the mean
+        double minimum = INFINITY;      // The smallest sample
+        double maximum = -INFINITY;     // The largest sample
+        LogBins positive;               // The positive samples
+        LogBins negative;               // The magnitudes of the negative samples
+        uint64_t zeros = 0;             // The samples counted as zero
+
+        void add(double value) {
+            count++;
+            double delta = value - mean;
+            mean += delta / count;
+            squares += delta * (value - mean);
+            minimum = min(minimum, value);
+            maximum = max(maximum, value);
+            if (abs(value) < PERCENTILE_ZERO)
+                zeros++;
+            else
+                (value > 0 ? positive : negative).add(static_cast<int>(ceil(log(abs(value)) / LOG_GAMMA)), 1);
+        }
+
+        void merge(const CurrentStatistics &other) {
+            if (other.count == 0)
+                return;
+            uint64_t total = count + other.count;
+            double delta = other.mean - mean;
+            mean += delta * other.count / total;
+            squares += other.squares + delta * delta * count * other.count / total;
+            count = total;
+            minimum = min(minimum, other.minimum);
+            maximum = max(maximum, other.maximum);
+            for (size_t i = 0; i < other.positive.counts.size(); i++) {
+                if (other.positive.counts[i] > 0)
+                    positive.add(other.positive.offset + static_cast<int>(i), other.positive.counts[i]);
+            }
+            for (size_t i = 0; i < other.negative.counts.size(); i++) {
+                if (other.negative.counts[i] > 0)
+                    negative.add(other.negative.offset + static_cast<int>(i), other.negative.counts[i]);
+            }
+            zeros += other.zeros;
+        }
+
+        double variance() const {
+            return count > 1 ? squares / (count - 1) : 0;
+        }
+
+        double percentile(double fraction) const {
+            // The value of the bin that holds the sample with this rank
+            uint64_t rank = static_cast<uint64_t>(fraction * (count - 1));
+            auto binValue = [](int bin) {
+                return 2 * exp(bin * LOG_GAMMA) / (1 + exp(LOG_GAMMA));
+            };
+            double value = maximum;
+            for (size_t i = negative.counts.size(); i-- > 0;) {
+                if (rank < negative.counts[i]) {
+                    value = -binValue(negative.offset + static_cast<int>(i));
+                    return clamp(value, minimum, maximum);
+                }
+                rank -= negative.counts[i];
+            }
+            if (rank < zeros)
+                return clamp(0.0, minimum, maximum);
+            rank -= zeros;
+            for (size_t i = 0; i < positive.counts.size(); i++) {
+                if (rank < positive.counts[i]) {
+                    value = binValue(positive.offset + static_cast<int>(i));
+                    break;
+                }
+                rank -= positive.counts[i];
+            }
+            return clamp(value, minimum, maximum);
+        }
+    };
+}
+
+
+bool readTolerances(const string &fileName, const CircuitView &circuit, vector<Tolerance> &tolerances) {
+    ifstream file(fileName);
+    if (!file) {
+        logMessage(LogLevel::Error, "ERROR: There were problems loading ", fileName);
+        return false;
+    }
+
+    // The element IDs are found through a temporary lookup table
+    unordered_map<string_view, uint32_t> elements;
+    for (uint32_t e = 0; e < circuit.elementCount; e++)
+        elements.emplace(circuit.string(circuit.elementIDs[e]), e);
+
+    vector<bool> listed(circuit.elementCount, false);
+    Tolerance common{0, 0, false, ToleranceDistribution::Uniform};
+    bool has_common = false;
+    string line;
+    for (int number = 1; getline(file, line); number++) {
+        istringstream fields(line);
+        string ID, tolerance_text, distribution = "uniform", rest;
+        if (!(fields >> ID) || ID[0] == '#')
+            continue;
+
+        Tolerance tolerance{0, 0, false, ToleranceDistribution::Uniform};
+        fields >> tolerance_text >> distribution;
+        if (!tolerance_text.empty() && tolerance_text.back() == '%') {
+            tolerance.relative = true;
+            tolerance_text.pop_back();
+        }
+        bool valid = parseValue(tolerance_text, tolerance.tolerance) && tolerance.tolerance >= 0 &&
+            (distribution == "uniform" || distribution == "normal") && !(fields >> rest);
+        if (!valid) {
+            logMessage(LogLevel::Error, "ERROR: Invalid tolerance in line ", number, " of ", fileName,
+                ", it must be ID tolerance[%] [uniform|normal]");
+            return false;
+        }
+        if (tolerance.relative)
+            tolerance.tolerance /= 100;
+        if (distribution == "normal")
+            tolerance.distribution = ToleranceDistribution::Normal;
+
+        if (ID == "*") {
+            if (has_common) {
+                logMessage(LogLevel::Error, "ERROR: The common tolerance * is given more than once, in line ", number,
+                    " of ", fileName);
+                return false;
+            }
+            common = tolerance;
+            has_common = true;
+            continue;
+        }
+        auto found = elements.find(ID);
+        if (found == elements.end()) {
+            logMessage(LogLevel::Error, "WARNING: There is no element with ID ", ID, " in line ", number, " of ",
+                fileName);
+            continue;
+        }
+        if (listed[found->second]) {
+            logMessage(LogLevel::Error, "ERROR: The element ", ID, " has more than one tolerance, in line ", number,
+                " of ", fileName);
+            return false;
+        }
+        tolerance.element = found->second;
+        listed[found->second] = true;
+        tolerances.push_back(tolerance);
+    }
+
+    // The common tolerance goes to the elements without their own
+    for (uint32_t e = 0; e < circuit.elementCount && has_common; e++) {
+        if (!listed[e]) {
+            common.element = e;
+            tolerances.push_back(common);
+        }
+    }
+    sort(tolerances.begin(), tolerances.end(), [](const Tolerance &a, const Tolerance &b) {
+        return a.element < b.element;
+    });
+    return true;
+}
+
+
+bool runMonteCarlo(CircuitContext &context, const vector<Tolerance> &tolerances, size_t samples, uint64_t seed,
+    const ResultsOptions &options, const string &fileName) {
+    CircuitView circuit = context.view();
+
+    // Choose the branches whose statistics are written
+    vector<uint32_t> branches;
+    if (!options.probeIDs.empty()) {
+        vector<string> missing;
+        Probes probes = findProbes(circuit, options.probeIDs, missing);
+        for (const string &ID : missing)
+            logMessage(LogLevel::Error, "WARNING: There is no mesh, branch or element with ID ", ID);
+        if (!probes.meshes.empty() || !probes.elements.empty())
+            logMessage(LogLevel::Error, "WARNING: Only the statistics of branches are written, the other probes are ignored");
+        branches = probes.branches;
+    } else {
+        for (uint32_t b = 0; b < circuit.branchCount; b++)
+            branches.push_back(b);
+    }
+
+    // Solve the samples, each thread with its own copy of the circuit and its statistics
+    unsigned threads = threadCount(samples, MONTE_CARLO_SAMPLES_PER_THREAD);
+    vector<vector<CurrentStatistics>> statistics(threads, vector<CurrentStatistics>(branches.size()));
+    atomic<size_t> singular(0);
+    atomic<size_t> rejected(0);
+    parallelFor(samples, threads, [&](size_t begin, size_t end, unsigned t) {
+        CircuitContext local;
+        local.model.copyFrom(circuit);
+        local.engine = SolverEngine::Mesh;
+        local.deferResults = true;
+        CircuitEditor editor(local);
+        CircuitView copy = local.view();
+        vector<double> values(tolerances.size());
+        vector<double> branch_currents(circuit.branchCount);
+        for (size_t sample = begin; sample < end; sample++) {
+            // A resistance can't become negative, or zero if it was not, so such samples
+            // are skipped before editing the circuit
+            bool valid = true;
+            for (size_t k = 0; k < tolerances.size(); k++) {
+                uint32_t e = tolerances[k].element;
+                double nominal = circuit.elementValues[e];
+                values[k] = sampleValue(tolerances[k], nominal, seed, sample);
+                if (circuit.elementKinds[e] == ElementKind::Resistance &&
+                    (values[k] < 0 || (values[k] == 0 && nominal != 0)))
+                    valid = false;
+            }
+            if (!valid) {
+                rejected.fetch_add(1, memory_order_relaxed);
+                continue;
+            }
+            for (size_t k = 0; k < tolerances.size(); k++)
+                editor.setElementValue(tolerances[k].element, values[k]);
+            if (!editor.solve()) {
+                singular.fetch_add(1, memory_order_relaxed);
+                continue;
+            }
+
+            // The branch currents are the sums of the currents of the meshes that traverse them
+            const vector<double> &mesh_currents = local.results.meshCurrents;
+            fill(branch_currents.begin(), branch_currents.end(), 0.0);
+            for (uint32_t i = 0; i < copy.meshCount; i++) {
+                for (uint32_t k = copy.meshBranchOffsets[i]; k < copy.meshBranchOffsets[i + 1]; k++)
+                    branch_currents[copy.meshBranchIndices[k]] += copy.meshBranchSigns[k] * mesh_currents[i];
+            }
+            for (size_t c = 0; c < branches.size(); c++)
+                statistics[t][c].add(branch_currents[branches[c]]);
+        }
+    });
+    for (unsigned t = 1; t < threads; t++) {
+        for (size_t c = 0; c < branches.size(); c++)
+            statistics[0][c].merge(statistics[t][c]);
+    }
+    if (rejected.load() > 0)
+        logMessage(LogLevel::Error, "WARNING: ", rejected.load(), " samples were skipped, they gave a resistance that is not positive");
+    if (singular.load() > 0)
+        logMessage(LogLevel::Error, "WARNING: ", singular.load(), " samples can't be solved, their impedance matrix is singular");
+
+    // Write a line per branch
+    ResultsWriter writer;
+    if (!writer.open(fileName)) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+    writer.text("branch,samples,mean (A),variance (A2),minimum (A)");
+    for (double percentile : PERCENTILES)
+        writer.text(",p").number(percentile * 100).text(" (A)");
+    writer.text(",maximum (A)\n");
+    for (size_t c = 0; c < branches.size(); c++) {
+        const CurrentStatistics &branch = statistics[0][c];
+        writer.csvField(circuit.string(circuit.branchIDs[branches[c]])).text(",").text(to_string(branch.count));
+        if (branch.count == 0) {
+            writer.text(",,,,");
+            for (size_t p = 0; p < size(PERCENTILES); p++)
+                writer.text(",");
+            writer.text("\n");
+            continue;
+        }
+        writer.text(",").number(branch.mean).text(",").number(branch.variance()).text(",").number(branch.minimum);
+        for (double percentile : PERCENTILES)
+            writer.text(",").number(branch.percentile(percentile));
+        writer.text(",").number(branch.maximum).text("\n");
+    }
+    if (!writer.close()) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file MonteCarlo.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to find how the
+ * tolerances of the elements of a circuit spread its branch currents.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CircuitSolver.h"
+
+
+/*!
+ * \brief The distributions of the values of an element around its nominal value.
+ */
+enum class ToleranceDistribution {
+    Uniform,        // Any value within the tolerance is as likely
+    Normal          // Normal distribution whose standard deviation is a third of the tolerance
+};
+
+/*!
+ * \brief The tolerance of an element.
+ */
+struct Tolerance {
+    uint32_t element;                   // The index of the element
+    double tolerance;                   // The tolerance, relative to the value or in Ω or V
+    bool relative;                      // true if the tolerance is a fraction of the value
+    ToleranceDistribution distribution; // The distribution of the values
+};
+
+/*!
+* \brief Function that reads the tolerances of the elements of a circuit from a file.
+* 
+* Each line of the file has an element ID, its tolerance and, optionally, its
+* distribution, uniform (the default) or normal, separated by spaces. A tolerance
+* ending in % is relative to the value of the element, such as 5%, and any other is
+* given in ohms or volts, with the engineering suffixes of the circuit files. The ID
+* * stands for every element without its own line. Empty lines and lines starting
+* with # are skipped. An element, or *, given in more than one line is an error. Any
+* problem is reported.
+* 
+* \param t_fileName The name of the file
+* \param t_circuit The packed circuit
+* \param t_tolerances The tolerance of each element that has one
+* 
+* \return true if the file was read, false otherwise
+*/
+bool readTolerances(const std::string &t_fileName, const CircuitView &t_circuit,
+    std::vector<Tolerance> &t_tolerances);
+
+/*!
+* \brief Function that finds the statistics of the branch currents of a circuit whose
+* elements take random values within their tolerances.
+* 
+* The samples are split among all the processor threads, each with its own copy of
+* the circuit and of its mesh system, which are edited and factorized again for each
+* sample into the arrays of the previous one. The elements are edited by their index, not
+* found again by their IDs. The random values of a sample only depend on
+* the seed and on the number of the sample, so the results do not depend on the
+* number of threads, but for rounding in their last digits.
+* 
+* The statistics are accumulated as the samples are solved, so the samples are never
+* stored: the mean and the variance of the current of each branch, its extremes, and
+* its percentiles 1, 5, 50, 95 and 99, estimated with a relative error below 0.1 %.
+* They are written to a CSV file with a line per branch, for every branch or only the
+* branches of the probes of the options. Samples that give a resistance a negative
+* value, or zero when its value is not zero, and samples whose circuit can't be solved
+* are skipped and reported. Any problem is reported.
+* 
+* \param t_context The context of the loaded circuit
+* \param t_tolerances The tolerance of each element that has one
+* \param t_samples The number of samples
+* \param t_seed The seed of the random values
+* \param t_options The probes of the results to write, or none to write every branch
+* \param t_fileName The name of the CSV file
+* 
+* \return true if the statistics were written, false otherwise
+*/
+bool runMonteCarlo(CircuitContext &t_context, const std::vector<Tolerance> &t_tolerances, size_t t_samples,
+    uint64_t t_seed, const ResultsOptions &t_options, const std::string &t_fileName);
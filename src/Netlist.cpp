@@ -0,0 +1,238 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Netlist.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to find the
+ * independent loops of a circuit given by the nodes its branches connect.
+ */
+
+#include <algorithm>
+#include "Netlist.h"
+
+using namespace std;
+
+namespace {
+
+    // Maximum number of nodes visited when looking for a short loop
+    const size_t LOOP_SEARCH_LIMIT = 1024;
+
+    const uint32_t NONE = UINT32_MAX;
+
+    /*!
+    * \brief The edges incident to each node, in CSR form.
+    */
+    struct Adjacency {
+        vector<uint32_t> offsets;   // nodeCount + 1 offsets into edges
+        vector<uint32_t> edges;     // The incident edges of each node
+    };
+
+    uint32_t otherEnd(const NetlistEdge &edge, uint32_t node) {
+        return edge.from == node ? edge.to : edge.from;
+    }
+
+    /*!
+    * \brief Function that runs a BFS over a connected part, from a node.
+    *
+    * The nodes reached are marked with the stamp and left in order, in the order
+    * they were reached, and parentEdges tells the edge each one was reached through.
+    */
+    void breadthFirst(const Adjacency &adjacency, const vector<NetlistEdge> &edges, uint32_t root,
+        vector<uint32_t> &stamps, uint32_t stamp, vector<uint32_t> &parentEdges, vector<uint32_t> &order) {
+
+        order.clear();
+        order.push_back(root);
+        stamps[root] = stamp;
+        parentEdges[root] = NONE;
+        for (size_t head = 0; head < order.size(); head++) {
+            uint32_t node = order[head];
+            for (uint32_t k = adjacency.offsets[node]; k < adjacency.offsets[node + 1]; k++) {
+                uint32_t next = otherEnd(edges[adjacency.edges[k]], node);
+                if (stamps[next] != stamp) {
+                    stamps[next] = stamp;
+                    parentEdges[next] = adjacency.edges[k];
+                    order.push_back(next);
+                }
+            }
+        }
+    }
+
+}
+
+
+LoopBasis findLoops(uint32_t nodeCount, const vector<NetlistEdge> &edges) {
+
+    uint32_t edgeCount = static_cast<uint32_t>(edges.size());
+
+    // The edges incident to each node
+    Adjacency adjacency;
+    adjacency.offsets.assign(nodeCount + 1, 0);
+    for (auto &edge : edges) {
+        adjacency.offsets[edge.from + 1]++;
+        if (edge.to != edge.from)
+            adjacency.offsets[edge.to + 1]++;
+    }
+    for (uint32_t n = 0; n < nodeCount; n++)
+        adjacency.offsets[n + 1] += adjacency.offsets[n];
+    adjacency.edges.resize(adjacency.offsets[nodeCount]);
+    vector<uint32_t> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (uint32_t e = 0; e < edgeCount; e++) {
+        adjacency.edges[next[edges[e].from]++] = e;
+        if (edges[e].to != edges[e].from)
+            adjacency.edges[next[edges[e].to]++] = e;
+    }
+
+    // Grow a spanning tree in each connected part. Its root is the middle of a long
+    // path, found by two sweeps: the farthest node from any node, and the farthest
+    // node from that one
+    vector<uint32_t> stamps(nodeCount, 0);
+    uint32_t stamp = 0;
+    vector<uint32_t> parent_edges(nodeCount, NONE);
+    vector<uint32_t> depths(nodeCount, 0);
+    vector<uint32_t> ranks(nodeCount, 0);       // The position of each node in the BFS of its tree
+    vector<bool> tree_edges(edgeCount, false);
+    vector<bool> placed(nodeCount, false);
+    vector<uint32_t> order;
+    uint32_t rank = 0;
+    for (uint32_t start = 0; start < nodeCount; start++) {
+        if (placed[start])
+            continue;
+        breadthFirst(adjacency, edges, start, stamps, ++stamp, parent_edges, order);
+        uint32_t first_end = order.back();
+        breadthFirst(adjacency, edges, first_end, stamps, ++stamp, parent_edges, order);
+        uint32_t second_end = order.back();
+        uint32_t length = 0;
+        for (uint32_t node = second_end; node != first_end; node = otherEnd(edges[parent_edges[node]], node))
+            length++;
+        uint32_t root = second_end;
+        for (uint32_t step = 0; step < length / 2; step++)
+            root = otherEnd(edges[parent_edges[root]], root);
+
+        breadthFirst(adjacency, edges, root, stamps, ++stamp, parent_edges, order);
+        for (uint32_t node : order) {
+            placed[node] = true;
+            ranks[node] = rank++;
+            if (parent_edges[node] != NONE) {
+                tree_edges[parent_edges[node]] = true;
+                depths[node] = depths[otherEnd(edges[parent_edges[node]], node)] + 1;
+            }
+        }
+    }
+    vector<uint32_t> tree_parents(parent_edges);
+
+    // Sort the edges out of the tree from the root outwards, by the rank of their
+    // farthest node
+    vector<uint32_t> chord_offsets(nodeCount + 1, 0);
+    auto chordRank = [&](uint32_t e) { return max(ranks[edges[e].from], ranks[edges[e].to]); };
+    for (uint32_t e = 0; e < edgeCount; e++) {
+        if (!tree_edges[e])
+            chord_offsets[chordRank(e) + 1]++;
+    }
+    for (uint32_t r = 0; r < nodeCount; r++)
+        chord_offsets[r + 1] += chord_offsets[r];
+    vector<uint32_t> chords(chord_offsets[nodeCount]);
+    for (uint32_t e = 0; e < edgeCount; e++) {
+        if (!tree_edges[e])
+            chords[chord_offsets[chordRank(e)]++] = e;
+    }
+
+    // Close a loop with each edge out of the tree
+    LoopBasis loops;
+    loops.offsets.reserve(chords.size() + 1);
+    vector<bool> available(tree_edges);
+    vector<uint32_t> path;
+    vector<int8_t> path_signs;
+    vector<uint32_t> queue;
+    for (uint32_t chord : chords) {
+        uint32_t from = edges[chord].from;
+        uint32_t to = edges[chord].to;
+
+        // The loop goes through the chord in its direction, and comes back from its
+        // end to its start through available edges. Look for the shortest way back
+        path.clear();
+        path_signs.clear();
+        bool found = from == to;
+        if (!found) {
+            stamp++;
+            queue.clear();
+            queue.push_back(to);
+            stamps[to] = stamp;
+            for (size_t head = 0; head < queue.size() && !found && queue.size() <= LOOP_SEARCH_LIMIT; head++) {
+                uint32_t node = queue[head];
+                for (uint32_t k = adjacency.offsets[node]; k < adjacency.offsets[node + 1]; k++) {
+                    uint32_t e = adjacency.edges[k];
+                    uint32_t other = otherEnd(edges[e], node);
+                    if (!available[e] || stamps[other] == stamp)
+                        continue;
+                    stamps[other] = stamp;
+                    parent_edges[other] = e;
+                    queue.push_back(other);
+                    if (other == from) {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (found) {
+                // Walk the way back from its start, then reverse it
+                for (uint32_t node = from; node != to; ) {
+                    uint32_t e = parent_edges[node];
+                    uint32_t previous = otherEnd(edges[e], node);
+                    path.push_back(e);
+                    path_signs.push_back(edges[e].from == previous ? 1 : -1);
+                    node = previous;
+                }
+                reverse(path.begin(), path.end());
+                reverse(path_signs.begin(), path_signs.end());
+            }
+        }
+
+        if (!found) {
+            // Fall back to the path through the tree: up from the end of the chord
+            // to the common ancestor, then down to its start
+            vector<uint32_t> down;
+            vector<int8_t> down_signs;
+            uint32_t up_node = to;
+            uint32_t down_node = from;
+            while (up_node != down_node) {
+                if (depths[up_node] >= depths[down_node]) {
+                    uint32_t e = tree_parents[up_node];
+                    path.push_back(e);
+                    path_signs.push_back(edges[e].from == up_node ? 1 : -1);
+                    up_node = otherEnd(edges[e], up_node);
+                } else {
+                    uint32_t e = tree_parents[down_node];
+                    down.push_back(e);
+                    down_signs.push_back(edges[e].to == down_node ? 1 : -1);
+                    down_node = otherEnd(edges[e], down_node);
+                }
+            }
+            path.insert(path.end(), down.rbegin(), down.rend());
+            path_signs.insert(path_signs.end(), down_signs.rbegin(), down_signs.rend());
+        }
+
+        loops.edges.push_back(chord);
+        loops.signs.push_back(1);
+        loops.edges.insert(loops.edges.end(), path.begin(), path.end());
+        loops.signs.insert(loops.signs.end(), path_signs.begin(), path_signs.end());
+        loops.offsets.push_back(static_cast<uint32_t>(loops.edges.size()));
+        available[chord] = true;
+    }
+    return loops;
+}
@@ -0,0 +1,75 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Netlist.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to find the
+ * independent loops of a circuit given by the nodes its branches connect.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+
+/*!
+ * \brief A branch of a netlist.
+ *
+ * An struct which defines the nodes a branch connects. The branch current flows
+ * from the node from to the node to.
+ */
+struct NetlistEdge {
+    uint32_t from;      // The index of the node the branch starts at
+    uint32_t to;        // The index of the node the branch ends at
+};
+
+/*!
+ * \brief A basis of independent loops.
+ *
+ * The edges of the loop i are edges[offsets[i]] ... edges[offsets[i + 1] - 1], in
+ * the order the loop traverses them, and signs tells whether the loop goes in the
+ * direction of the edge (+1) or in the opposite one (-1).
+ */
+struct LoopBasis {
+    std::vector<uint32_t> offsets = {0};    // loopCount + 1 offsets into edges and signs
+    std::vector<uint32_t> edges;            // The edge index of each loop entry
+    std::vector<int8_t> signs;              // The orientation of each loop entry
+};
+
+/*!
+* \brief Function that finds a basis of independent loops of a netlist.
+* 
+* A BFS spanning tree is grown in each connected part of the netlist, rooted at an
+* approximate centre so that the tree is shallow. Every edge out of the tree closes
+* one loop, so there are edges - nodes + parts loops. The edges out of the tree are
+* taken from the root outwards, and each one is closed by the shortest path made of
+* tree edges and the edges already closed, found by a search of bounded size, or by
+* its fundamental cycle in the tree if the search gives up. Each loop holds its own
+* edge and only edges closed before it, so the loops are independent. On mesh-like
+* circuits most loops are faces, so the impedance matrix stays as sparse as the one
+* of a circuit with meshes given by hand.
+* 
+* Its cost is linear in the size of the netlist plus the size of the loops.
+* 
+* \param t_nodeCount The number of nodes
+* \param t_edges The edges, as pairs of node indices
+* 
+* \return The loops
+*/
+LoopBasis findLoops(uint32_t t_nodeCount, const std::vector<NetlistEdge> &t_edges);
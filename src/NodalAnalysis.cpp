@@ -0,0 +1,261 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file NodalAnalysis.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to solve a
+ * circuit given by its nodes with modified nodal analysis.
+ */
+
+#include <algorithm>
+#include <numeric>
+#include "NodalAnalysis.h"
+
+using namespace std;
+
+namespace {
+
+    /*!
+    * \brief Function that returns the ground node of each connected part of a circuit.
+    *
+    * \return true for the nodes which are grounds
+    */
+    vector<bool> findGrounds(const CircuitView &circuit) {
+
+        // Join the nodes of each branch
+        vector<uint32_t> parents(circuit.nodeCount);
+        iota(parents.begin(), parents.end(), 0);
+        auto root = [&](uint32_t node) {
+            while (parents[node] != node) {
+                parents[node] = parents[parents[node]];
+                node = parents[node];
+            }
+            return node;
+        };
+        vector<uint32_t> degrees(circuit.nodeCount, 0);
+        for (uint32_t b = 0; b < circuit.branchCount; b++) {
+            uint32_t from = circuit.branchNodes[2 * b];
+            uint32_t to = circuit.branchNodes[2 * b + 1];
+            if (from == to)
+                continue;
+            degrees[from]++;
+            degrees[to]++;
+            parents[root(from)] = root(to);
+        }
+
+        // The node with the most branches of each part is its ground
+        vector<uint32_t> part_grounds(circuit.nodeCount, NO_UNKNOWN);
+        for (uint32_t n = 0; n < circuit.nodeCount; n++) {
+            uint32_t &ground = part_grounds[root(n)];
+            if (ground == NO_UNKNOWN || degrees[n] > degrees[ground])
+                ground = n;
+        }
+        vector<bool> grounds(circuit.nodeCount, false);
+        for (uint32_t n = 0; n < circuit.nodeCount; n++) {
+            if (part_grounds[n] != NO_UNKNOWN)
+                grounds[part_grounds[n]] = true;
+        }
+        return grounds;
+    }
+
+    /*!
+    * \brief Function that returns the impedance and the voltage of each branch.
+    */
+    void branchValues(const CircuitView &circuit, vector<double> &impedances, vector<double> &voltages) {
+        impedances.assign(circuit.branchCount, 0.0);
+        voltages.assign(circuit.branchCount, 0.0);
+        for (uint32_t b = 0; b < circuit.branchCount; b++) {
+            for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+                if (circuit.elementKinds[e] == ElementKind::Resistance)
+                    impedances[b] += circuit.elementValues[e];
+                else
+                    voltages[b] += circuit.elementValues[e];
+            }
+        }
+    }
+
+}
+
+
+SystemSize nodalSystemSize(const CircuitView &circuit) {
+    vector<bool> grounds = findGrounds(circuit);
+    vector<double> impedances, voltages;
+    branchValues(circuit, impedances, voltages);
+
+    SystemSize size;
+    for (uint32_t n = 0; n < circuit.nodeCount; n++) {
+        if (!grounds[n])
+            size.dimension++;
+    }
+    size.nonZeros = size.dimension;
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        uint32_t from = circuit.branchNodes[2 * b];
+        uint32_t to = circuit.branchNodes[2 * b + 1];
+        size_t free_ends = (grounds[from] ? 0 : 1) + (grounds[to] ? 0 : 1);
+        if (impedances[b] != 0.0) {
+            // The conductance between two free nodes
+            if (from != to && free_ends == 2)
+                size.nonZeros += 2;
+        } else {
+            // A row and a column with a unit for each free node
+            size.dimension++;
+            size.nonZeros += 2 * free_ends;
+        }
+    }
+    return size;
+}
+
+
+NodalSystem createNodalSystem(const CircuitView &circuit) {
+
+    NodalSystem system;
+    vector<double> impedances;
+    branchValues(circuit, impedances, system.branchVoltages);
+
+    // Number the unknowns: the voltages of the free nodes, then the currents of
+    // the branches without resistance
+    vector<bool> grounds = findGrounds(circuit);
+    uint32_t unknowns = 0;
+    system.nodeUnknowns.assign(circuit.nodeCount, NO_UNKNOWN);
+    for (uint32_t n = 0; n < circuit.nodeCount; n++) {
+        if (!grounds[n])
+            system.nodeUnknowns[n] = unknowns++;
+    }
+    system.branchUnknowns.assign(circuit.branchCount, NO_UNKNOWN);
+    system.branchConductances.assign(circuit.branchCount, 0.0);
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        if (impedances[b] != 0.0)
+            system.branchConductances[b] = 1.0 / impedances[b];
+        else
+            system.branchUnknowns[b] = unknowns++;
+    }
+
+    // Stamp every branch into a list of (column, row, value) entries. The current
+    // that leaves the node from through a branch with resistance is
+    // G x (V_from - V_to + E), and a branch without resistance fixes V_from - V_to = -E
+    struct Entry {
+        uint32_t column;
+        uint32_t row;
+        double value;
+    };
+    vector<Entry> entries;
+    entries.reserve(unknowns + 4 * static_cast<size_t>(circuit.branchCount));
+    system.currents.assign(unknowns, 0.0);
+    auto stamp = [&](uint32_t row, uint32_t column, double value) {
+        if (row != NO_UNKNOWN && column != NO_UNKNOWN)
+            entries.push_back(Entry{column, row, value});
+    };
+    for (uint32_t n = 0; n < circuit.nodeCount; n++)
+        stamp(system.nodeUnknowns[n], system.nodeUnknowns[n], 0.0);
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        uint32_t from = system.nodeUnknowns[circuit.branchNodes[2 * b]];
+        uint32_t to = system.nodeUnknowns[circuit.branchNodes[2 * b + 1]];
+        double voltage = system.branchVoltages[b];
+        if (system.branchUnknowns[b] == NO_UNKNOWN) {
+            // A branch that starts and ends at the same node has no effect on the nodes
+            if (circuit.branchNodes[2 * b] == circuit.branchNodes[2 * b + 1])
+                continue;
+            double conductance = system.branchConductances[b];
+            stamp(from, from, conductance);
+            stamp(to, to, conductance);
+            stamp(from, to, -conductance);
+            stamp(to, from, -conductance);
+            if (from != NO_UNKNOWN)
+                system.currents[from] -= conductance * voltage;
+            if (to != NO_UNKNOWN)
+                system.currents[to] += conductance * voltage;
+        } else {
+            uint32_t current = system.branchUnknowns[b];
+            stamp(from, current, 1.0);
+            stamp(to, current, -1.0);
+            stamp(current, from, 1.0);
+            stamp(current, to, -1.0);
+            system.currents[current] = -voltage;
+        }
+    }
+
+    // Sort the entries by column, then compress each column sorting it by row and
+    // adding up the repeated rows
+    SparseMatrix &matrix = system.conductanceMatrix;
+    matrix.dim = static_cast<int>(unknowns);
+    vector<int> offsets(unknowns + 1, 0);
+    for (auto &entry : entries)
+        offsets[entry.column + 1]++;
+    for (uint32_t j = 0; j < unknowns; j++)
+        offsets[j + 1] += offsets[j];
+    vector<pair<int, double>> sorted(entries.size());
+    vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (auto &entry : entries)
+        sorted[next[entry.column]++] = make_pair(static_cast<int>(entry.row), entry.value);
+    matrix.columnOffsets.reserve(unknowns + 1);
+    matrix.columnOffsets.push_back(0);
+    matrix.rowIndices.reserve(sorted.size());
+    matrix.values.reserve(sorted.size());
+    for (uint32_t j = 0; j < unknowns; j++) {
+        sort(sorted.begin() + offsets[j], sorted.begin() + offsets[j + 1],
+            [](const pair<int, double> &a, const pair<int, double> &b) { return a.first < b.first; });
+        for (int p = offsets[j]; p < offsets[j + 1]; p++) {
+            if (static_cast<int>(matrix.rowIndices.size()) > matrix.columnOffsets.back() &&
+                matrix.rowIndices.back() == sorted[p].first)
+                matrix.values.back() += sorted[p].second;
+            else {
+                matrix.rowIndices.push_back(sorted[p].first);
+                matrix.values.push_back(sorted[p].second);
+            }
+        }
+        matrix.columnOffsets.push_back(static_cast<int>(matrix.rowIndices.size()));
+    }
+    return system;
+}
+
+
+void setNodalCurrents(const CircuitView &circuit, const NodalSystem &system, const vector<double> &solution,
+    vector<double> &meshCurrents, vector<double> &branchCurrents) {
+
+    // The voltage of each node, zero for the grounds
+    auto nodeVoltage = [&](uint32_t node) {
+        uint32_t unknown = system.nodeUnknowns[node];
+        return unknown == NO_UNKNOWN ? 0.0 : solution[unknown];
+    };
+
+    // The current through each branch
+    branchCurrents.assign(circuit.branchCount, 0.0);
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        if (system.branchUnknowns[b] != NO_UNKNOWN) {
+            branchCurrents[b] = solution[system.branchUnknowns[b]];
+        } else {
+            branchCurrents[b] = system.branchConductances[b] * (nodeVoltage(circuit.branchNodes[2 * b]) -
+                nodeVoltage(circuit.branchNodes[2 * b + 1]) + system.branchVoltages[b]);
+        }
+    }
+
+    // The current through each mesh, from the last mesh to the first one. Each
+    // branch accumulates the currents of the meshes already known that traverse it
+    meshCurrents.assign(circuit.meshCount, 0.0);
+    vector<double> known(circuit.branchCount, 0.0);
+    for (uint32_t i = circuit.meshCount; i-- > 0; ) {
+        uint32_t first = circuit.meshBranchOffsets[i];
+        if (first == circuit.meshBranchOffsets[i + 1])
+            continue;
+        uint32_t b = circuit.meshBranchIndices[first];
+        meshCurrents[i] = circuit.meshBranchSigns[first] * (branchCurrents[b] - known[b]);
+        for (uint32_t k = first; k < circuit.meshBranchOffsets[i + 1]; k++)
+            known[circuit.meshBranchIndices[k]] += circuit.meshBranchSigns[k] * meshCurrents[i];
+    }
+}
@@ -0,0 +1,102 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file NodalAnalysis.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to solve a
+ * circuit given by its nodes with modified nodal analysis.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CircuitView.h"
+#include "LinearSystemSolver.h"
+
+// Unknown of the nodes whose voltage is zero and of the branches with resistance
+const uint32_t NO_UNKNOWN = UINT32_MAX;
+
+
+/*!
+ * \brief The size of a linear equations system.
+ */
+struct SystemSize {
+    size_t dimension = 0;               // The number of unknowns
+    size_t nonZeros = 0;                // The number of non-zero elements of the matrix, at most
+};
+
+/*!
+ * \brief A modified nodal analysis system.
+ *
+ * An struct which defines the equations system G x X = J. The unknowns X are the
+ * voltages of the nodes, except one ground node of each connected part of the circuit
+ * whose voltage is zero, followed by the currents of the branches without resistance.
+ * Each branch with resistance is replaced by its Norton equivalent, so it adds its
+ * conductance to G and the current of its batteries to J. Each branch without
+ * resistance adds a row that fixes the voltage between its nodes.
+ */
+struct NodalSystem {
+    SparseMatrix conductanceMatrix;         // The matrix G (S), with the rows of the branches without resistance
+    std::vector<double> currents;           // The vector J of injected currents (A) and branch voltages (V)
+    std::vector<uint32_t> nodeUnknowns;     // The unknown of each node, or NO_UNKNOWN for the grounds
+    std::vector<uint32_t> branchUnknowns;   // The unknown of each branch without resistance, or NO_UNKNOWN
+    std::vector<double> branchConductances; // The conductance of each branch (S), zero if it has no resistance
+    std::vector<double> branchVoltages;     // The voltage of the batteries of each branch (V)
+};
+
+/*!
+* \brief Function that returns the size of the nodal system of a circuit, without building it.
+* 
+* \param t_circuit The packed circuit, which must have nodes
+* 
+* \return The size of the system
+*/
+SystemSize nodalSystemSize(const CircuitView &t_circuit);
+
+/*!
+* \brief Function that returns the modified nodal analysis system of a circuit.
+* 
+* The ground of each connected part is its node with the most branches, which removes
+* the most non-zero elements from the matrix. The rows of each column of the matrix
+* are sorted.
+* 
+* \param t_circuit The packed circuit, which must have nodes
+* 
+* \return The nodal system
+*/
+NodalSystem createNodalSystem(const CircuitView &t_circuit);
+
+/*!
+* \brief Function that computes the currents of a circuit from the solution of its nodal system.
+* 
+* The branch currents follow from the node voltages, or are part of the solution for
+* branches without resistance. The mesh currents are then recovered from the meshes
+* backwards: the first branch of each mesh is only traversed by that mesh and the ones
+* after it, so the current of the mesh is the one of that branch minus the currents of
+* the later meshes that traverse it.
+* 
+* \param t_circuit The packed circuit, which must have nodes
+* \param t_system The nodal system of the circuit
+* \param t_solution The solution of the nodal system
+* \param t_meshCurrents The vector of mesh currents to be filled (A)
+* \param t_branchCurrents The vector of branch currents to be filled (A)
+*/
+void setNodalCurrents(const CircuitView &t_circuit, const NodalSystem &t_system,
+    const std::vector<double> &t_solution, std::vector<double> &t_meshCurrents,
+    std::vector<double> &t_branchCurrents);
@@ -0,0 +1,232 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Parallel.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to split a loop
+ * among several threads.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Parallel.h"
+
+using namespace std;
+
+unsigned threadCount(size_t count, size_t minimumPerThread) {
+    size_t hardware_threads = max(1u, thread::hardware_concurrency());
+    size_t useful_threads = max<size_t>(1, count / max<size_t>(1, minimumPerThread));
+    return static_cast<unsigned>(min(hardware_threads, useful_threads));
+}
+
+
+namespace {
+
+    /*!
+    * \brief A call to parallelFor, whose ranges are taken by the pool threads and the caller.
+    */
+    struct RangeBatch {
+        const function<void(size_t, size_t, unsigned)> *body;
+        size_t count;                   // The number of iterations
+        unsigned ranges;                // The number of ranges
+        atomic<unsigned> next{0};       // The next range to be taken
+        unsigned done = 0;              // The number of ranges finished
+        mutex lock;                     // Taken to wait for the ranges
+        condition_variable finished;    // Notified when the last range finishes
+
+        /*!
+        * \brief Function that runs the range r of the batch, taken from next.
+        *
+        * The count of finished ranges changes under the lock, so the caller cannot see
+        * the batch finished, and destroy it, before this function stops using it.
+        */
+        void runRange(unsigned r) {
+            (*body)(count * r / ranges, count * (r + 1) / ranges, r);
+            lock_guard<mutex> guard(lock);
+            if (++done == ranges)
+                finished.notify_all();
+        }
+    };
+
+
+    /*!
+    * \brief The threads that run the ranges of parallelFor.
+    *
+    * The pool is created on the first parallel loop and its threads live as long as the
+    * program, so a loop does not pay for starting threads. The caller of a loop also
+    * takes its ranges until none is left, so a loop started from a pool thread, or when
+    * every pool thread is busy, still finishes.
+    */
+    class ThreadPool {
+    public:
+        ThreadPool() {
+            unsigned threads = max(1u, thread::hardware_concurrency()) - 1;
+            m_threads.reserve(threads);
+            for (unsigned t = 0; t < threads; t++)
+                m_threads.emplace_back(&ThreadPool::work, this);
+        }
+
+        ~ThreadPool() {
+            {
+                lock_guard<mutex> guard(m_lock);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto &worker : m_threads)
+                worker.join();
+        }
+
+        /*!
+        * \brief Function that runs every range of a batch and waits for them.
+        */
+        void run(RangeBatch &batch) {
+            if (!m_threads.empty()) {
+                {
+                    lock_guard<mutex> guard(m_lock);
+                    m_batches.push_back(&batch);
+                }
+                if (batch.ranges > 2)
+                    m_wake.notify_all();
+                else
+                    m_wake.notify_one();
+            }
+
+            for (unsigned r = batch.next++; r < batch.ranges; r = batch.next++)
+                batch.runRange(r);
+
+            // Every range is taken, so no pool thread must find the batch any more
+            if (!m_threads.empty()) {
+                lock_guard<mutex> guard(m_lock);
+                auto position = find(m_batches.begin(), m_batches.end(), &batch);
+                if (position != m_batches.end())
+                    m_batches.erase(position);
+            }
+            unique_lock<mutex> guard(batch.lock);
+            batch.finished.wait(guard, [&] { return batch.done == batch.ranges; });
+        }
+
+    private:
+        /*!
+        * \brief Function that runs the ranges of the queued batches until the pool stops.
+        */
+        void work() {
+            unique_lock<mutex> guard(m_lock);
+            while (true) {
+                m_wake.wait(guard, [&] { return m_stop || !m_batches.empty(); });
+                if (m_stop)
+                    return;
+
+                // Take a range of the oldest batch, which stays queued until its ranges
+                // are all taken. The range is taken under the lock, while the batch is
+                // queued and so alive, and the batch cannot finish before it is run
+                RangeBatch *batch = m_batches.front();
+                unsigned r = batch->next++;
+                if (r >= batch->ranges) {
+                    m_batches.pop_front();
+                    continue;
+                }
+                guard.unlock();
+                batch->runRange(r);
+                guard.lock();
+            }
+        }
+
+        vector<thread> m_threads;
+        mutex m_lock;                       // Taken to queue or take a batch
+        condition_variable m_wake;          // Notified when a batch is queued or the pool stops
+        deque<RangeBatch *> m_batches;      // The batches whose ranges are not all taken
+        bool m_stop = false;
+    };
+
+}
+
+
+void parallelFor(size_t count, unsigned threads, const function<void(size_t, size_t, unsigned)> &body) {
+    if (threads <= 1) {
+        body(0, count, 0);
+        return;
+    }
+
+    static ThreadPool pool;
+    RangeBatch batch;
+    batch.body = &body;
+    batch.count = count;
+    batch.ranges = threads;
+    pool.run(batch);
+}
+
+
+namespace {
+
+    /*!
+    * \brief The tasks of a thread, which other threads may steal.
+    */
+    struct TaskQueue {
+        mutex lock;                     // Taken to add, run or steal a task
+        deque<size_t> tasks;            // The tasks not started yet
+    };
+
+    /*!
+    * \brief Function that takes the next task of a thread, or steals one from another.
+    * 
+    * \return true if a task was taken, false if no thread has tasks left
+    */
+    bool takeTask(vector<TaskQueue> &queues, unsigned t, size_t &task) {
+        {
+            lock_guard<mutex> guard(queues[t].lock);
+            if (!queues[t].tasks.empty()) {
+                task = queues[t].tasks.front();
+                queues[t].tasks.pop_front();
+                return true;
+            }
+        }
+
+        // Steal the last task of the next thread that has any
+        for (size_t k = 1; k < queues.size(); k++) {
+            TaskQueue &victim = queues[(t + k) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+
+void parallelTasks(size_t count, unsigned threads, const function<void(size_t, unsigned)> &body) {
+    threads = static_cast<unsigned>(max<size_t>(1, min<size_t>(threads, count)));
+    vector<TaskQueue> queues(threads);
+    for (size_t i = 0; i < count; i++)
+        queues[i % threads].tasks.push_back(i);
+
+    // Tasks are never added once the threads start, so a thread stops when every queue is empty
+    parallelFor(threads, threads, [&](size_t, size_t, unsigned t) {
+        size_t task;
+        while (takeTask(queues, t, task))
+            body(task, t);
+    });
+}
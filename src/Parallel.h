@@ -0,0 +1,75 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Parallel.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to split a loop
+ * among several threads.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+
+
+/*!
+* \brief Function that returns the number of threads worth using for a loop.
+* 
+* It is the number of hardware threads, limited so that every thread gets at least
+* t_minimumPerThread iterations. Small loops get a single thread.
+* 
+* \param t_count The number of iterations of the loop
+* \param t_minimumPerThread The minimum number of iterations of each thread
+* 
+* \return The number of threads, at least 1
+*/
+unsigned threadCount(size_t t_count, size_t t_minimumPerThread);
+
+/*!
+* \brief Function that splits a loop among several threads.
+* 
+* The iterations [0, t_count) are split in t_threads contiguous ranges of similar
+* size, and the range t goes before the range t + 1. t_function(begin, end, t) is
+* called once for each range, and the function returns when all the ranges are done.
+* The ranges are run by a pool of threads created on the first call, and by the
+* calling thread, which takes ranges until none is left. So the loop may be nested in
+* another one, and its ranges may run on fewer threads than t_threads.
+* 
+* \param t_count The number of iterations of the loop
+* \param t_threads The number of threads
+* \param t_function The function that runs the iterations [begin, end) on the thread t
+*/
+void parallelFor(size_t t_count, unsigned t_threads,
+    const std::function<void(size_t, size_t, unsigned)> &t_function);
+
+/*!
+* \brief Function that runs a list of tasks of different sizes on several threads.
+* 
+* The tasks are dealt to the threads in turn, so each thread gets some of the first
+* tasks, and every thread runs its own tasks in order. A thread that runs out of tasks
+* steals the last task of another thread, so the threads stay busy until all the
+* tasks are done. The tasks should be given from the largest to the smallest.
+* t_function(i, t) is called for the task i on the thread t, and the function returns
+* when all the tasks are done.
+* 
+* \param t_count The number of tasks
+* \param t_threads The number of threads
+* \param t_function The function that runs the task i on the thread t
+*/
+void parallelTasks(size_t t_count, unsigned t_threads, const std::function<void(size_t, unsigned)> &t_function);
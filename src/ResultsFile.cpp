@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsFile.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to save the
+ * results of a circuit into a binary file.
+ */
+
+#include <cstring>
+#include <fstream>
+#include "ResultsFile.h"
+#include "FileSections.h"
+
+using namespace std;
+
+namespace {
+
+    // FNV-1a parameters of the hash of the index
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const uint64_t FNV_PRIME = 1099511628211ull;
+
+    /*!
+    * \brief Function that adds an item to the index.
+    */
+    void addToIndex(vector<ResultsIndexEntry> &index, const CircuitView &circuit, uint32_t stringIndex,
+        ResultKind kind, uint32_t position) {
+
+        size_t mask = index.size() - 1;
+        size_t slot = resultsHash(circuit.string(stringIndex)) & mask;
+        while (index[slot].stringIndex != NOT_FOUND)
+            slot = (slot + 1) & mask;
+        index[slot] = {stringIndex, kind, position, 0};
+    }
+
+}
+
+
+uint64_t resultsHash(string_view ID) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (char c : ID) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+
+bool saveResultsFile(const CircuitView &circuit, const vector<double> &meshCurrents,
+    const vector<double> &branchCurrents, const vector<double> &elementPowers, const string &fileName) {
+
+    ResultsFileHeader header = {};
+    memcpy(header.magic, RESULTS_FILE_MAGIC, sizeof(header.magic));
+    header.version = RESULTS_FILE_VERSION;
+    header.byteOrder = CIRCUIT_FILE_BYTE_ORDER;
+    header.stringCount = circuit.stringCount;
+    header.meshCount = circuit.meshCount;
+    header.branchCount = circuit.branchCount;
+    header.elementCount = circuit.elementCount;
+    header.stringDataSize = circuit.stringOffsets[circuit.stringCount];
+
+    // Build the index, at most half full so the searches stay short
+    size_t items = static_cast<size_t>(circuit.meshCount) + circuit.branchCount + circuit.elementCount;
+    size_t index_size = 1;
+    while (index_size < 2 * items)
+        index_size *= 2;
+    if (index_size > UINT32_MAX)
+        return false;
+    header.indexSize = static_cast<uint32_t>(index_size);
+    vector<ResultsIndexEntry> index(index_size, {NOT_FOUND, ResultKind::Mesh, 0, 0});
+    for (uint32_t i = 0; i < circuit.meshCount; i++)
+        addToIndex(index, circuit, circuit.meshIDs[i], ResultKind::Mesh, i);
+    for (uint32_t b = 0; b < circuit.branchCount; b++)
+        addToIndex(index, circuit, circuit.branchIDs[b], ResultKind::Branch, b);
+    for (uint32_t e = 0; e < circuit.elementCount; e++)
+        addToIndex(index, circuit, circuit.elementIDs[e], ResultKind::Element, e);
+
+    ofstream file(fileName, ios::binary | ios::trunc);
+    if (!file)
+        return false;
+
+    // Write a placeholder header, then the sections, then the final header
+    writeSection(file, &header, sizeof(header));
+    header.sectionOffsets[RESULTS_STRING_OFFSETS] =
+        writeSection(file, circuit.stringOffsets, (header.stringCount + 1ull) * sizeof(uint32_t));
+    header.sectionOffsets[RESULTS_STRING_DATA] =
+        writeSection(file, circuit.stringData, header.stringDataSize);
+    header.sectionOffsets[RESULTS_MESH_IDS] =
+        writeSection(file, circuit.meshIDs, header.meshCount * sizeof(uint32_t));
+    header.sectionOffsets[RESULTS_BRANCH_IDS] =
+        writeSection(file, circuit.branchIDs, header.branchCount * sizeof(uint32_t));
+    header.sectionOffsets[RESULTS_ELEMENT_IDS] =
+        writeSection(file, circuit.elementIDs, header.elementCount * sizeof(uint32_t));
+    header.sectionOffsets[RESULTS_MESH_CURRENTS] =
+        writeSection(file, meshCurrents.data(), header.meshCount * sizeof(double));
+    header.sectionOffsets[RESULTS_BRANCH_CURRENTS] =
+        writeSection(file, branchCurrents.data(), header.branchCount * sizeof(double));
+    header.sectionOffsets[RESULTS_ELEMENT_POWERS] =
+        writeSection(file, elementPowers.data(), header.elementCount * sizeof(double));
+    header.sectionOffsets[RESULTS_INDEX] =
+        writeSection(file, index.data(), index_size * sizeof(ResultsIndexEntry));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    file.close();
+    return !file.fail();
+}
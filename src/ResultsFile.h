@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsFile.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to save the
+ * results of a circuit into a binary file, which other programs can map into
+ * memory and read without parsing.
+ *
+ * A binary results file starts with a ResultsFileHeader followed by the interned
+ * IDs of the circuit, the IDs of its meshes, branches and elements, one column with
+ * each kind of result, and an index from the IDs to their positions. Each section
+ * is aligned to 8 bytes, and everything is written in the native byte order.
+ *
+ * The index is a hash table of indexSize entries, a power of two. The entry of an
+ * ID is looked for from the position given by the 64-bit FNV-1a hash of its
+ * characters modulo indexSize, moving to the next entry (and from the last one to
+ * the first) until an entry with the ID and the kind requested is found, or an empty
+ * entry is reached.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CircuitView.h"
+#include "CircuitModel.h"
+#include "CircuitFile.h"
+
+const char RESULTS_FILE_MAGIC[4] = {'C', 'S', 'B', 'R'};   // The first bytes of a binary results file
+const uint32_t RESULTS_FILE_VERSION = 1;                    // The version of the binary results format
+
+/*!
+ * \brief The sections of a binary results file.
+ */
+enum ResultsFileSection {
+    RESULTS_STRING_OFFSETS = 0,
+    RESULTS_STRING_DATA,
+    RESULTS_MESH_IDS,
+    RESULTS_BRANCH_IDS,
+    RESULTS_ELEMENT_IDS,
+    RESULTS_MESH_CURRENTS,
+    RESULTS_BRANCH_CURRENTS,
+    RESULTS_ELEMENT_POWERS,
+    RESULTS_INDEX,
+    RESULTS_SECTION_COUNT
+};
+
+/*!
+ * \brief The kind of circuit item a result belongs to.
+ */
+enum class ResultKind : uint32_t {
+    Mesh = 0,           // A mesh current
+    Branch = 1,         // A branch current
+    Element = 2         // An element power
+};
+
+/*!
+ * \brief The header of a binary results file.
+ */
+struct ResultsFileHeader {
+    char magic[4];                                  // RESULTS_FILE_MAGIC
+    uint32_t version;                               // RESULTS_FILE_VERSION
+    uint32_t byteOrder;                             // CIRCUIT_FILE_BYTE_ORDER
+    uint32_t stringCount;                           // The number of interned strings
+    uint32_t meshCount;                             // The number of meshes
+    uint32_t branchCount;                           // The number of branches
+    uint32_t elementCount;                          // The number of elements
+    uint32_t indexSize;                             // The number of entries of the index
+    uint64_t stringDataSize;                        // The size of the string characters (bytes)
+    uint64_t sectionOffsets[RESULTS_SECTION_COUNT]; // The position of each section in the file (bytes)
+};
+
+/*!
+ * \brief An entry of the index of a binary results file.
+ */
+struct ResultsIndexEntry {
+    uint32_t stringIndex;       // The interned ID, or NOT_FOUND if the entry is empty
+    ResultKind kind;            // The kind of item with this ID
+    uint32_t position;          // The position of the item in the column of its kind
+    uint32_t reserved;          // Zero
+};
+
+/*!
+* \brief Function that returns the hash of an ID used by the index of a results file.
+*
+* \param t_ID The ID
+*
+* \return The 64-bit FNV-1a hash of its characters
+*/
+uint64_t resultsHash(std::string_view t_ID);
+
+/*!
+* \brief Function that saves the results of a packed circuit into a binary file.
+*
+* \param t_circuit The packed circuit
+* \param t_meshCurrents The current through each mesh (A)
+* \param t_branchCurrents The current through each branch (A)
+* \param t_elementPowers The power dissipated by each element (W)
+* \param t_fileName The name of the binary results file
+*
+* \return true if the file was written, false otherwise
+*/
+bool saveResultsFile(const CircuitView &t_circuit, const std::vector<double> &t_meshCurrents,
+    const std::vector<double> &t_branchCurrents, const std::vector<double> &t_elementPowers,
+    const std::string &t_fileName);
@@ -0,0 +1,141 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsView.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the results view.
+ */
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_set>
+#include "ResultsView.h"
+
+using namespace std;
+
+
+Probes findProbes(const CircuitView &circuit, const vector<string> &IDs, vector<string> &missing) {
+    unordered_set<string_view> requested(IDs.begin(), IDs.end());
+    unordered_set<string_view> found;
+    Probes probes;
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        string_view ID = circuit.string(circuit.meshIDs[i]);
+        if (requested.count(ID)) {
+            probes.meshes.push_back(i);
+            found.insert(ID);
+        }
+    }
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        string_view ID = circuit.string(circuit.branchIDs[b]);
+        if (requested.count(ID)) {
+            probes.branches.push_back(b);
+            found.insert(ID);
+        }
+    }
+    for (uint32_t e = 0; e < circuit.elementCount; e++) {
+        string_view ID = circuit.string(circuit.elementIDs[e]);
+        if (requested.count(ID)) {
+            probes.elements.push_back(e);
+            found.insert(ID);
+        }
+    }
+    for (const string &ID : IDs) {
+        if (!found.count(ID))
+            missing.push_back(ID);
+    }
+    return probes;
+}
+
+
+BranchMeshes findBranchMeshes(const CircuitView &circuit) {
+    // Count the meshes of each branch, and then place each mesh in its branches
+    BranchMeshes branch_meshes;
+    branch_meshes.offsets.assign(circuit.branchCount + 1, 0);
+    branch_meshes.meshes.resize(circuit.incidenceCount());
+    branch_meshes.signs.resize(circuit.incidenceCount());
+    for (uint32_t k = 0; k < circuit.incidenceCount(); k++)
+        branch_meshes.offsets[circuit.meshBranchIndices[k] + 1]++;
+    for (uint32_t b = 0; b < circuit.branchCount; b++)
+        branch_meshes.offsets[b + 1] += branch_meshes.offsets[b];
+    vector<uint32_t> next(branch_meshes.offsets.begin(), branch_meshes.offsets.end() - 1);
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++) {
+            uint32_t position = next[circuit.meshBranchIndices[k]]++;
+            branch_meshes.meshes[position] = i;
+            branch_meshes.signs[position] = circuit.meshBranchSigns[k];
+        }
+    }
+    return branch_meshes;
+}
+
+
+ResultsView::ResultsView(const CircuitView &circuit, const vector<double> &meshCurrents,
+    const vector<double> &branchCurrents, const vector<double> &elementPowers, const BranchMeshes *branchMeshes)
+    : m_circuit(circuit), m_meshCurrents(meshCurrents), m_knownCurrents(branchCurrents),
+    m_knownPowers(elementPowers), m_branchMeshes(branchMeshes) {
+}
+
+
+void ResultsView::evaluate(const vector<uint32_t> &branches) {
+    if (m_knownCurrents.size() == m_circuit.branchCount)
+        return;
+
+    // Add the current of every mesh that traverses each branch still unknown
+    for (uint32_t b : branches) {
+        if (m_branchCurrents.count(b))
+            continue;
+        if (m_branchMeshes == nullptr) {
+            m_ownBranchMeshes = findBranchMeshes(m_circuit);
+            m_branchMeshes = &m_ownBranchMeshes;
+        }
+        double current = 0.0;
+        for (uint32_t l = m_branchMeshes->offsets[b]; l < m_branchMeshes->offsets[b + 1]; l++)
+            current += m_branchMeshes->signs[l] * m_meshCurrents[m_branchMeshes->meshes[l]];
+        m_branchCurrents[b] = current;
+    }
+}
+
+
+double ResultsView::branchCurrent(uint32_t branch) {
+    if (m_knownCurrents.size() == m_circuit.branchCount)
+        return m_knownCurrents[branch];
+    auto found = m_branchCurrents.find(branch);
+    if (found != m_branchCurrents.end())
+        return found->second;
+    evaluate({branch});
+    return m_branchCurrents[branch];
+}
+
+
+double ResultsView::elementPower(uint32_t element) {
+    if (m_knownPowers.size() == m_circuit.elementCount)
+        return m_knownPowers[element];
+    if (m_circuit.elementKinds[element] != ElementKind::Resistance)
+        return 0.0;
+    double current = branchCurrent(elementBranch(element));
+    return current * current * m_circuit.elementValues[element];
+}
+
+
+uint32_t ResultsView::elementBranch(uint32_t element) const {
+    // The elements are grouped by branch, so the branch is the last one that starts
+    // at or before the element
+    const uint32_t *offsets = m_circuit.branchElementOffsets;
+    return static_cast<uint32_t>(upper_bound(offsets, offsets + m_circuit.branchCount + 1, element) - offsets) - 1;
+}
@@ -0,0 +1,175 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsView.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the results view, which computes the
+ * currents and powers of a solved circuit only when they are needed.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CircuitView.h"
+
+
+/*!
+ * \brief The meshes, branches and elements whose results are requested.
+ */
+struct Probes {
+    std::vector<uint32_t> meshes;       // The index of each requested mesh
+    std::vector<uint32_t> branches;     // The index of each requested branch
+    std::vector<uint32_t> elements;     // The index of each requested element
+};
+
+/*!
+* \brief Function that finds the meshes, branches and elements with the given IDs.
+* 
+* The IDs of the whole circuit are scanned once. An ID used by both a mesh and a
+* branch, for instance, requests both of them.
+* 
+* \param t_circuit The packed circuit
+* \param t_IDs The requested IDs
+* \param t_missing The IDs which were not found, to be filled
+* 
+* \return The requested meshes, branches and elements, in the order of the circuit
+*/
+Probes findProbes(const CircuitView &t_circuit, const std::vector<std::string> &t_IDs,
+    std::vector<std::string> &t_missing);
+
+
+/*!
+ * \brief The transpose of the mesh-branch incidence, which lists the meshes that traverse each branch.
+ */
+struct BranchMeshes {
+    std::vector<uint32_t> offsets;      // Where the meshes of each branch start, and their total at the end
+    std::vector<uint32_t> meshes;       // The index of each mesh that traverses each branch
+    std::vector<int8_t> signs;          // +1 if the mesh traverses the branch in its direction, -1 otherwise
+};
+
+/*!
+* \brief Function that lists the meshes that traverse each branch of a circuit.
+* 
+* The meshes of each branch are in increasing order.
+* 
+* \param t_circuit The packed circuit
+* 
+* \return The transpose of the mesh-branch incidence of the circuit
+*/
+BranchMeshes findBranchMeshes(const CircuitView &t_circuit);
+
+
+/*!
+ * \brief The results of a solved circuit, computed on demand.
+ *
+ * A class that gives the current of a branch and the power of an element from the
+ * mesh currents of a circuit the first time they are requested, and remembers them.
+ * The current of a branch is the sum of the currents of the meshes that traverse it,
+ * found in the transpose of the mesh-branch incidence. The transpose is given by the
+ * owner of the circuit, or built by the view the first time it computes a current.
+ * If the branch currents or the element powers are already known, they are used instead.
+ */
+class ResultsView {
+
+    private:
+        CircuitView m_circuit;                          // The packed circuit
+        const std::vector<double> &m_meshCurrents;      // The current through each mesh (A)
+        const std::vector<double> &m_knownCurrents;     // The current through each branch (A), if they are known
+        const std::vector<double> &m_knownPowers;       // The power dissipated by each element (W), if they are known
+        const BranchMeshes *m_branchMeshes;             // The meshes that traverse each branch, or null if not built yet
+        BranchMeshes m_ownBranchMeshes;                 // The meshes that traverse each branch, if the view builds them
+        std::unordered_map<uint32_t, double> m_branchCurrents; // The currents computed so far (A)
+
+    public:
+        /*!
+        * \brief Constructor.
+        *
+        * \param t_circuit The packed circuit
+        * \param t_meshCurrents The current through each mesh (A)
+        * \param t_branchCurrents The current through each branch (A), or an empty vector
+        * if they have to be computed
+        * \param t_elementPowers The power dissipated by each element (W), or an empty vector
+        * if they have to be computed
+        * \param t_branchMeshes The meshes that traverse each branch of the circuit, which must
+        * outlive the view, or null if the view has to build them
+        */
+        ResultsView(const CircuitView &t_circuit, const std::vector<double> &t_meshCurrents,
+            const std::vector<double> &t_branchCurrents, const std::vector<double> &t_elementPowers,
+            const BranchMeshes *t_branchMeshes = nullptr);
+
+        /*!
+        * \brief Function that computes the currents of several branches.
+        *
+        * Only the meshes that traverse the branches are read, so the cost does not
+        * depend on the size of the circuit once the transpose of the incidence is built.
+        *
+        * \param t_branches The index of each branch
+        */
+        void evaluate(const std::vector<uint32_t> &t_branches);
+
+        /*!
+        * \brief Function that tells if every result is already known.
+        *
+        * \return true if the view never computes anything, so it can be read by several threads
+        */
+        bool isComplete() const {
+            return m_knownCurrents.size() == m_circuit.branchCount && m_knownPowers.size() == m_circuit.elementCount;
+        }
+
+        /*!
+        * \brief Function that returns the current through a mesh.
+        *
+        * \param t_mesh The index of the mesh
+        *
+        * \return The current (A)
+        */
+        double meshCurrent(uint32_t t_mesh) const {
+            return m_meshCurrents[t_mesh];
+        }
+
+        /*!
+        * \brief Function that returns the current through a branch.
+        *
+        * \param t_branch The index of the branch
+        *
+        * \return The current (A), positive in the direction of the branch
+        */
+        double branchCurrent(uint32_t t_branch);
+
+        /*!
+        * \brief Function that returns the power dissipated by an element.
+        *
+        * \param t_element The index of the element
+        *
+        * \return The power (W), zero for batteries
+        */
+        double elementPower(uint32_t t_element);
+
+        /*!
+        * \brief Function that returns the branch an element belongs to.
+        *
+        * \param t_element The index of the element
+        *
+        * \return The index of the branch
+        */
+        uint32_t elementBranch(uint32_t t_element) const;
+
+};
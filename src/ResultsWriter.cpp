@@ -0,0 +1,116 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsWriter.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the results writer.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include "ResultsWriter.h"
+
+using namespace std;
+
+// Longest text of a double written by to_chars (bytes)
+const size_t NUMBER_MAX_SIZE = 32;
+
+
+ResultsWriter::ResultsWriter() : m_stream(nullptr), m_buffer(WRITER_BUFFER_SIZE) {
+}
+
+
+bool ResultsWriter::open(const string &fileName) {
+    m_used = 0;
+    m_file.open(fileName);
+    m_stream.rdbuf(m_file.rdbuf());
+    m_failed = !m_file.is_open();
+    return !m_failed;
+}
+
+
+void ResultsWriter::open(streambuf *buffer) {
+    m_used = 0;
+    m_stream.rdbuf(buffer);
+    m_failed = buffer == nullptr;
+}
+
+
+void ResultsWriter::reserve(size_t size) {
+    if (m_used + size <= m_buffer.size())
+        return;
+    if (m_stream.rdbuf() == nullptr) {
+        // Without a stream, the text is kept in the buffer
+        m_buffer.resize(max(2 * m_buffer.size(), m_used + size));
+        return;
+    }
+    flush();
+    if (size > m_buffer.size())
+        m_buffer.resize(size);
+}
+
+
+ResultsWriter &ResultsWriter::text(string_view text) {
+    reserve(text.size());
+    memcpy(m_buffer.data() + m_used, text.data(), text.size());
+    m_used += text.size();
+    return *this;
+}
+
+
+ResultsWriter &ResultsWriter::number(double value) {
+    reserve(NUMBER_MAX_SIZE);
+    to_chars_result result = to_chars(m_buffer.data() + m_used, m_buffer.data() + m_buffer.size(), value);
+    m_used = result.ptr - m_buffer.data();
+    return *this;
+}
+
+
+ResultsWriter &ResultsWriter::csvField(string_view field) {
+    if (field.find_first_of(",\"\r\n") == string_view::npos)
+        return text(field);
+    text("\"");
+    for (char c : field)
+        text(c == '"' ? string_view("\"\"") : string_view(&c, 1));
+    return text("\"");
+}
+
+
+void ResultsWriter::flush() {
+    if (m_stream.rdbuf() == nullptr)
+        return;
+    if (m_used > 0 && !m_failed) {
+        m_stream.write(m_buffer.data(), m_used);
+        m_failed = !m_stream;
+    }
+    m_used = 0;
+}
+
+
+bool ResultsWriter::close() {
+    flush();
+    if (!m_failed && !m_stream.flush())
+        m_failed = true;
+    if (m_file.is_open()) {
+        m_file.close();
+        m_failed = m_failed || m_file.fail();
+    }
+    return !m_failed;
+}
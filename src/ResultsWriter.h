@@ -0,0 +1,139 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ResultsWriter.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the results writer, which writes text
+ * files through a large buffer.
+ */
+
+#pragma once
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Size of the buffer of a results writer (bytes)
+const size_t WRITER_BUFFER_SIZE = 1 << 20;
+
+
+/*!
+ * \brief A buffered text file writer.
+ *
+ * A class that appends text and numbers to a buffer and writes it to the file in
+ * large blocks when it is full, so writing a line costs a copy instead of a call to
+ * the stream. Numbers are written with the shortest text that reads back as the same
+ * value.
+ *
+ * A writer that has not been opened keeps all the text in its buffer, which grows as
+ * needed, so several threads can format parts of a file in their own writers.
+ */
+class ResultsWriter {
+
+    private:
+        std::ofstream m_file;           // The file being written, if the writer opened it
+        std::ostream m_stream;          // The stream the buffer is written to
+        std::vector<char> m_buffer;     // The text not written yet
+        size_t m_used = 0;              // The number of bytes of the buffer in use
+        bool m_failed = false;          // true if the file could not be opened or written
+
+        /*!
+        * \brief Function that makes room for a number of bytes in the buffer.
+        */
+        void reserve(size_t t_size);
+
+    public:
+        /*!
+        * \brief Default constructor.
+        */
+        ResultsWriter();
+
+        /*!
+        * \brief Function that opens a file, creating it or discarding its content.
+        *
+        * \param t_fileName The name of the file
+        *
+        * \return true if the file was opened, false otherwise
+        */
+        bool open(const std::string &t_fileName);
+
+        /*!
+        * \brief Function that writes to a stream buffer, such as the one of the standard output.
+        *
+        * \param t_buffer The stream buffer, which must outlive the writer
+        */
+        void open(std::streambuf *t_buffer);
+
+        /*!
+        * \brief Function that appends text.
+        *
+        * \param t_text The text
+        *
+        * \return The writer
+        */
+        ResultsWriter &text(std::string_view t_text);
+
+        /*!
+        * \brief Function that appends a number.
+        *
+        * \param t_value The number
+        *
+        * \return The writer
+        */
+        ResultsWriter &number(double t_value);
+
+        /*!
+        * \brief Function that appends a field of a CSV record, quoted if needed.
+        *
+        * \param t_text The text of the field
+        *
+        * \return The writer
+        */
+        ResultsWriter &csvField(std::string_view t_text);
+
+        /*!
+        * \brief Function that returns the text in the buffer.
+        *
+        * \return The text not written yet
+        */
+        std::string_view buffered() const {
+            return std::string_view(m_buffer.data(), m_used);
+        }
+
+        /*!
+        * \brief Function that discards the text in the buffer.
+        */
+        void clear() {
+            m_used = 0;
+        }
+
+        /*!
+        * \brief Function that writes the buffer to the file.
+        */
+        void flush();
+
+        /*!
+        * \brief Function that writes the buffer and closes the file, if the writer opened it.
+        *
+        * \return true if everything was written, false otherwise
+        */
+        bool close();
+
+};
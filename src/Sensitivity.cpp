@@ -0,0 +1,121 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Sensitivity.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to find how the
+ * currents of a circuit change with the values of its elements.
+ */
+
+#include "Sensitivity.h"
+#include "Log.h"
+
+using namespace std;
+
+
+bool runSensitivity(CircuitContext &context, const ResultsOptions &options, const string &fileName) {
+    CircuitView circuit = context.view();
+
+    // Find the meshes and branches whose currents are derived
+    vector<string> missing;
+    Probes probes = findProbes(circuit, options.probeIDs, missing);
+    for (const string &ID : missing)
+        logMessage(LogLevel::Error, "WARNING: There is no mesh, branch or element with ID ", ID);
+    if (!probes.elements.empty())
+        logMessage(LogLevel::Error, "WARNING: Only the currents of meshes and branches are derived, the elements are ignored");
+    if (probes.meshes.empty() && probes.branches.empty()) {
+        logMessage(LogLevel::Error, "ERROR: The sensitivities need the ID of a mesh or a branch in --probe");
+        return false;
+    }
+
+    // Solve the circuit, keeping the factorization of its impedance matrix
+    context.engine = SolverEngine::Mesh;
+    context.deferResults = true;
+    if (!solveCircuit(context)) {
+        logMessage(LogLevel::Error, "ERROR: The circuit can't be solved, its impedance matrix is singular");
+        return false;
+    }
+    const vector<double> &mesh_currents = context.results.meshCurrents;
+    vector<double> branch_currents(circuit.branchCount, 0.0);
+    for (uint32_t i = 0; i < circuit.meshCount; i++) {
+        for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++)
+            branch_currents[circuit.meshBranchIndices[k]] += circuit.meshBranchSigns[k] * mesh_currents[i];
+    }
+
+    // The meshes that traverse each branch, to build the adjoint sources of the branches
+    BranchMeshes branch_meshes = findBranchMeshes(circuit);
+
+    // Solve the adjoint system of each probe, and keep B^T x λ for every branch
+    size_t outputs = probes.meshes.size() + probes.branches.size();
+    vector<vector<double>> adjoint_currents(outputs, vector<double>(circuit.branchCount, 0.0));
+    SolveWorkspace workspace;
+    for (size_t p = 0; p < outputs; p++) {
+        SparseVector source;
+        if (p < probes.meshes.size()) {
+            source.indices.push_back(static_cast<int>(probes.meshes[p]));
+            source.values.push_back(1.0);
+        } else {
+            uint32_t b = probes.branches[p - probes.meshes.size()];
+            for (uint32_t k = branch_meshes.offsets[b]; k < branch_meshes.offsets[b + 1]; k++) {
+                source.indices.push_back(static_cast<int>(branch_meshes.meshes[k]));
+                source.values.push_back(branch_meshes.signs[k]);
+            }
+        }
+        SparseVector adjoint = solveLUSparse(context.factorization, source, workspace);
+        vector<double> &currents = adjoint_currents[p];
+        for (size_t j = 0; j < adjoint.indices.size(); j++) {
+            uint32_t i = static_cast<uint32_t>(adjoint.indices[j]);
+            for (uint32_t k = circuit.meshBranchOffsets[i]; k < circuit.meshBranchOffsets[i + 1]; k++)
+                currents[circuit.meshBranchIndices[k]] += circuit.meshBranchSigns[k] * adjoint.values[j];
+        }
+    }
+
+    ResultsWriter writer;
+    if (!writer.open(fileName)) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+
+    // Write the header line, with a column per probe
+    writer.text("element,kind,value");
+    for (uint32_t i : probes.meshes)
+        writer.text(",").csvField(circuit.string(circuit.meshIDs[i]));
+    for (uint32_t b : probes.branches)
+        writer.text(",").csvField(circuit.string(circuit.branchIDs[b]));
+    writer.text("\n");
+
+    // Write a line per element, in a single pass over the elements of each branch
+    for (uint32_t b = 0; b < circuit.branchCount; b++) {
+        for (uint32_t e = circuit.branchElementOffsets[b]; e < circuit.branchElementOffsets[b + 1]; e++) {
+            bool resistance = circuit.elementKinds[e] == ElementKind::Resistance;
+            writer.csvField(circuit.string(circuit.elementIDs[e])).text(resistance ? ",resistance," : ",battery,")
+                  .number(circuit.elementValues[e]);
+            for (size_t p = 0; p < outputs; p++) {
+                double adjoint = adjoint_currents[p][b];
+                writer.text(",").number(resistance ? -adjoint * branch_currents[b] : adjoint);
+            }
+            writer.text("\n");
+        }
+    }
+    if (!writer.close()) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Sensitivity.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to find how the
+ * currents of a circuit change with the values of its elements.
+ */
+
+#pragma once
+#include <string>
+#include "CircuitSolver.h"
+
+
+/*!
+* \brief Function that finds the derivatives of some currents of a circuit with
+* respect to the value of every element.
+* 
+* With Z x I = B x E the mesh system of the circuit, a current y = c^T x I of a mesh
+* or a branch, and λ the solution of the adjoint system Z^T x λ = c, changing the
+* resistance of the branch b changes y by -(B_b^T x λ) x i_b per ohm, with B_b the
+* column of the branch in B and i_b its current, and changing a battery of the branch
+* changes y by B_b^T x λ per volt. So every derivative of a current is found with the
+* factorization of Z and a single solve of the adjoint system, which is a sparse solve
+* as c only has the meshes of the mesh or branch, followed by a pass over the meshes
+* and the elements. Z is symmetric, so the adjoint system is solved with the same
+* factorization as the mesh system.
+* 
+* The derivatives are written to a CSV file with a line per element: its ID, its kind,
+* its value and the derivative of the current of each probe, in A/Ω for resistances
+* and A/V for batteries. Only the meshes and branches of the probes are used. Any
+* problem is reported.
+* 
+* \param t_context The context of the loaded circuit, which is solved with mesh analysis
+* \param t_options The probes whose currents are derived
+* \param t_fileName The name of the CSV file
+* 
+* \return true if the derivatives were written, false otherwise
+*/
+bool runSensitivity(CircuitContext &t_context, const ResultsOptions &t_options, const std::string &t_fileName);
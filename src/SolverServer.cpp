@@ -0,0 +1,442 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file SolverServer.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the solver server.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include "SolverServer.h"
+#include "CircuitEditor.h"
+#include "ResultsFile.h"
+#include "Log.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+/*!
+ * \brief What every version of a served circuit shares, which the requests can't change.
+ */
+struct CircuitTopology {
+    CircuitModel model;                     // The circuit when it was loaded, whose values are not read
+    BranchMeshes branchMeshes;              // The meshes that traverse each branch
+
+    explicit CircuitTopology(const CircuitModel &t_model) :
+        model(t_model), branchMeshes(findBranchMeshes(model.view())) {}
+};
+
+/*!
+ * \brief A version of a served circuit, which is never changed once published.
+ */
+struct CircuitSnapshot {
+    uint64_t version;                       // The number of the version, 1 for the first solve
+    shared_ptr<const CircuitTopology> topology; // The meshes, branches, elements and IDs of the circuit
+    vector<double> elementValues;           // The value of each element when it was solved (Ω or V)
+    vector<double> meshCurrents;            // The current of each mesh (A)
+
+    CircuitSnapshot(uint64_t t_version, shared_ptr<const CircuitTopology> t_topology, const CircuitView &t_circuit,
+        const vector<double> &t_meshCurrents) :
+        version(t_version), topology(move(t_topology)),
+        elementValues(t_circuit.elementValues, t_circuit.elementValues + t_circuit.elementCount),
+        meshCurrents(t_meshCurrents) {}
+
+    /*!
+    * \brief Function that returns the circuit of the version.
+    */
+    CircuitView view() const {
+        CircuitView circuit = topology->model.view();
+        circuit.elementValues = elementValues.data();
+        return circuit;
+    }
+};
+
+/*!
+ * \brief A circuit loaded by a client, solved with mesh analysis.
+ */
+struct ServedCircuit {
+    mutex lock;                             // Taken to change and solve the circuit
+    CircuitContext context;                 // The circuit, its system and its mesh currents
+    unique_ptr<CircuitEditor> editor;       // The editor that changes and solves the circuit
+    shared_ptr<const CircuitTopology> topology; // What every version shares
+    shared_ptr<const CircuitSnapshot> snapshot; // The last version, only read and written atomically
+
+    /*!
+    * \brief Function that publishes the solved circuit as its next version.
+    *
+    * Only the values of the elements and the mesh currents are copied, the rest of
+    * the circuit is shared with the other versions.
+    *
+    * \return The number of the version
+    */
+    uint64_t publish() {
+        if (!topology)
+            topology = make_shared<const CircuitTopology>(context.model);
+        shared_ptr<const CircuitSnapshot> last = atomic_load(&snapshot);
+        uint64_t version = last ? last->version + 1 : 1;
+        atomic_store(&snapshot, shared_ptr<const CircuitSnapshot>(
+            make_shared<CircuitSnapshot>(version, topology, context.view(), context.results.meshCurrents)));
+        return version;
+    }
+};
+
+namespace {
+
+    /*!
+    * \brief A reader of the payload of a request, which fails instead of reading past its end.
+    */
+    struct RequestReader {
+        const vector<char> &data;           // The request
+        size_t position;                    // The position of the next value
+        bool failed = false;                // true if a value was past the end of the request
+
+        template <typename T>
+        T number() {
+            T value{};
+            if (position + sizeof(T) > data.size()) {
+                failed = true;
+                return value;
+            }
+            memcpy(&value, data.data() + position, sizeof(T));
+            position += sizeof(T);
+            return value;
+        }
+
+        string_view text() {
+            uint16_t length = number<uint16_t>();
+            if (failed || position + length > data.size()) {
+                failed = true;
+                return string_view();
+            }
+            string_view value(data.data() + position, length);
+            position += length;
+            return value;
+        }
+    };
+
+    template <typename T>
+    void appendNumber(vector<char> &answer, T value) {
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        answer.insert(answer.end(), bytes, bytes + sizeof(T));
+    }
+
+#ifndef _WIN32
+    bool readAll(int socket, void *data, size_t size) {
+        char *bytes = static_cast<char *>(data);
+        while (size > 0) {
+            ssize_t count = read(socket, bytes, size);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            bytes += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    bool writeAll(int socket, const void *data, size_t size) {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            ssize_t count = write(socket, bytes, size);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            bytes += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+#endif
+
+}
+
+
+SolverServer::~SolverServer() {
+#ifndef _WIN32
+    if (m_listener >= 0) {
+        close(m_listener);
+        unlink(m_path.c_str());
+    }
+#endif
+}
+
+
+bool SolverServer::open(const string &path) {
+#ifdef _WIN32
+    m_error = "The solver server needs Unix domain sockets, which this build does not support";
+    return false;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        m_error = "The path of the socket is empty or too long";
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Replace the socket of a previous server, but no other file
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        unlink(path.c_str());
+
+    m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listener < 0 || bind(m_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(m_listener, SOMAXCONN) != 0) {
+        m_error = "The socket " + path + " can't be created: " + strerror(errno);
+        if (m_listener >= 0)
+            close(m_listener);
+        m_listener = -1;
+        return false;
+    }
+    m_path = path;
+
+    // A client that disconnects before its answer must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+#endif
+}
+
+
+void SolverServer::run() {
+#ifndef _WIN32
+    logMessage(LogLevel::Info, "Serving circuits on ", m_path);
+    while (!m_stopping.load()) {
+        int client = accept(m_listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (!m_stopping.load())
+                logMessage(LogLevel::Error, "ERROR: The server can't accept clients: ", strerror(errno));
+            break;
+        }
+        {
+            lock_guard<mutex> guard(m_lock);
+            m_clients.push_back(client);
+        }
+        {
+            lock_guard<mutex> guard(m_threadsLock);
+            m_activeThreads++;
+        }
+        thread(&SolverServer::serve, this, client).detach();
+    }
+
+    // Disconnect the clients and wait for their threads
+    {
+        lock_guard<mutex> guard(m_lock);
+        for (int client : m_clients)
+            shutdown(client, SHUT_RDWR);
+    }
+    unique_lock<mutex> guard(m_threadsLock);
+    m_threadsFinished.wait(guard, [this] { return m_activeThreads == 0; });
+    logMessage(LogLevel::Info, "The server has stopped");
+#endif
+}
+
+
+void SolverServer::serve(int client) {
+#ifndef _WIN32
+    vector<char> request;
+    vector<char> answer;
+    while (true) {
+        uint32_t size;
+        if (!readAll(client, &size, sizeof(size)) || size == 0 || size > SERVER_MAX_REQUEST_SIZE)
+            break;
+        request.resize(size);
+        if (!readAll(client, request.data(), size))
+            break;
+
+        // The size of the answer is written once it is known
+        ServerCommand command = static_cast<ServerCommand>(request[0]);
+        answer.assign(sizeof(uint32_t) + 1, 0);
+        bool done = handle(command, request, answer);
+        answer[sizeof(uint32_t)] = static_cast<char>(done ? ServerStatus::Ok : ServerStatus::Error);
+        uint32_t answer_size = static_cast<uint32_t>(answer.size() - sizeof(uint32_t));
+        memcpy(answer.data(), &answer_size, sizeof(answer_size));
+        if (!writeAll(client, answer.data(), answer.size()))
+            break;
+
+        // Stop accepting clients once the client knows the server stops
+        if (done && command == ServerCommand::Shutdown) {
+            m_stopping.store(true);
+            shutdown(m_listener, SHUT_RDWR);
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(m_lock);
+        m_clients.erase(std::find(m_clients.begin(), m_clients.end(), client));
+        close(client);
+    }
+    lock_guard<mutex> guard(m_threadsLock);
+    m_activeThreads--;
+    m_threadsFinished.notify_all();
+#endif
+}
+
+
+shared_ptr<ServedCircuit> SolverServer::find(uint32_t circuit) {
+    lock_guard<mutex> guard(m_lock);
+    auto found = m_circuits.find(circuit);
+    return found != m_circuits.end() ? found->second : nullptr;
+}
+
+
+bool SolverServer::handle(ServerCommand command, const vector<char> &request, vector<char> &answer) {
+    RequestReader reader{request, 1};
+    auto fail = [&](const string &description) {
+        answer.resize(sizeof(uint32_t) + 1);
+        answer.insert(answer.end(), description.begin(), description.end());
+        return false;
+    };
+
+    switch (command) {
+        case ServerCommand::Load: {
+            string file_name(reader.text());
+            if (reader.failed)
+                return fail("The request is incomplete");
+
+            // Load and solve the circuit before anyone can use it
+            auto circuit = make_shared<ServedCircuit>();
+            circuit->context.engine = SolverEngine::Mesh;
+            circuit->context.deferResults = true;
+            if (!loadCircuit(file_name, circuit->context))
+                return fail("The circuit file " + file_name + " can't be loaded");
+            circuit->editor = make_unique<CircuitEditor>(circuit->context);
+            if (!circuit->editor->solve())
+                return fail("The circuit can't be solved, its impedance matrix is singular");
+            circuit->publish();
+
+            lock_guard<mutex> guard(m_lock);
+            uint32_t number = m_nextCircuit++;
+            m_circuits.emplace(number, move(circuit));
+            appendNumber(answer, number);
+            return true;
+        }
+
+        case ServerCommand::SetValue: {
+            uint32_t number = reader.number<uint32_t>();
+            string_view element_ID = reader.text();
+            double value = reader.number<double>();
+            if (reader.failed)
+                return fail("The request is incomplete");
+            shared_ptr<ServedCircuit> circuit = find(number);
+            if (!circuit)
+                return fail("There is no circuit " + to_string(number));
+            lock_guard<mutex> guard(circuit->lock);
+            if (!circuit->editor->setValue(element_ID, value))
+                return fail(circuit->editor->getError());
+            return true;
+        }
+
+        case ServerCommand::Solve: {
+            uint32_t number = reader.number<uint32_t>();
+            if (reader.failed)
+                return fail("The request is incomplete");
+            shared_ptr<ServedCircuit> circuit = find(number);
+            if (!circuit)
+                return fail("There is no circuit " + to_string(number));
+            lock_guard<mutex> guard(circuit->lock);
+            if (!circuit->editor->solve())
+                return fail(circuit->editor->getError());
+            appendNumber(answer, circuit->publish());
+            return true;
+        }
+
+        case ServerCommand::Query: {
+            uint32_t number = reader.number<uint32_t>();
+            uint32_t count = reader.number<uint32_t>();
+            // Each ID takes at least the two bytes of its length, so a count that
+            // doesn't fit in the rest of the request is refused before reserving
+            if (reader.failed || count > (request.size() - reader.position) / sizeof(uint16_t))
+                return fail("The request is incomplete");
+            shared_ptr<ServedCircuit> circuit = find(number);
+            if (!circuit)
+                return fail("There is no circuit " + to_string(number));
+
+            // Find every requested item first, so the currents of their branches are
+            // computed together
+            shared_ptr<const CircuitSnapshot> snapshot = atomic_load(&circuit->snapshot);
+            const CircuitModel &model = snapshot->topology->model;
+            vector<pair<ResultKind, uint32_t>> items;
+            vector<uint32_t> branches;
+            items.reserve(count);
+            for (uint32_t k = 0; k < count; k++) {
+                string_view ID = reader.text();
+                if (reader.failed)
+                    return fail("The request is incomplete");
+                uint32_t index;
+                if ((index = model.findMesh(ID)) != NOT_FOUND) {
+                    items.emplace_back(ResultKind::Mesh, index);
+                } else if ((index = model.findBranch(ID)) != NOT_FOUND) {
+                    items.emplace_back(ResultKind::Branch, index);
+                    branches.push_back(index);
+                } else if ((index = model.findElement(ID)) != NOT_FOUND) {
+                    items.emplace_back(ResultKind::Element, index);
+                    branches.push_back(model.elementBranch(index));
+                } else {
+                    return fail("There is no mesh, branch or element with ID " + string(ID));
+                }
+            }
+
+            // Only the requested results are computed, from the last version
+            const vector<double> computed;
+            ResultsView view(snapshot->view(), snapshot->meshCurrents, computed, computed,
+                &snapshot->topology->branchMeshes);
+            view.evaluate(branches);
+            appendNumber(answer, snapshot->version);
+            for (const auto &item : items) {
+                if (item.first == ResultKind::Mesh)
+                    appendNumber(answer, view.meshCurrent(item.second));
+                else if (item.first == ResultKind::Branch)
+                    appendNumber(answer, view.branchCurrent(item.second));
+                else
+                    appendNumber(answer, view.elementPower(item.second));
+            }
+            return true;
+        }
+
+        case ServerCommand::Unload: {
+            uint32_t number = reader.number<uint32_t>();
+            if (reader.failed)
+                return fail("The request is incomplete");
+            lock_guard<mutex> guard(m_lock);
+            if (m_circuits.erase(number) == 0)
+                return fail("There is no circuit " + to_string(number));
+            return true;
+        }
+
+        case ServerCommand::Shutdown:
+            return true;
+    }
+    return fail("Unknown command " + to_string(static_cast<int>(command)));
+}
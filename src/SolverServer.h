@@ -0,0 +1,163 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file SolverServer.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the solver server, which keeps circuits
+ * solved in memory and answers the requests of other programs through a local socket.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Largest request accepted by the server (bytes)
+const uint32_t SERVER_MAX_REQUEST_SIZE = 64 * 1024 * 1024;
+
+/*!
+ * \brief The requests of the solver protocol.
+ */
+enum class ServerCommand : uint8_t {
+    Load = 1,           // string file name -> uint32 circuit
+    SetValue = 2,       // uint32 circuit, string element ID, double value -> nothing
+    Solve = 3,          // uint32 circuit -> uint64 version
+    Query = 4,          // uint32 circuit, uint32 count, count strings -> uint64 version, count doubles
+    Unload = 5,         // uint32 circuit -> nothing
+    Shutdown = 6        // nothing -> nothing
+};
+
+/*!
+ * \brief The status of an answer of the solver protocol.
+ */
+enum class ServerStatus : uint8_t {
+    Ok = 0,             // The payload is the answer of the request
+    Error = 1           // The payload is the description of the error, without its length
+};
+
+struct ServedCircuit;
+
+
+/*!
+ * \brief A server that solves circuits for other programs.
+ *
+ * A class that listens on a Unix domain socket and keeps the circuits its clients
+ * load solved in memory, with the decomposition of their impedance matrices, so
+ * that changing the value of an element and solving the circuit again only repeats
+ * the work that depends on the change (see CircuitEditor).
+ *
+ * Every message, in both directions, is a uint32 with the size of the rest of the
+ * message, followed by a byte with the command of a request or the status of an
+ * answer, and its payload. Numbers are written in the byte order of the machine, as
+ * clients always run on it, and strings are written as a uint16 with their length
+ * followed by their characters. Clients send a request and wait for its answer, and
+ * each client is served by its own thread.
+ *
+ * A client loads a circuit file, which is solved, and gets the number that
+ * identifies it in the other requests. Queries take mesh, branch and element IDs,
+ * and answer the current of each mesh and branch (A) and the power dissipated by each
+ * element (W) since the last solve.
+ *
+ * Every solve publishes a new version of the circuit, an immutable snapshot of the
+ * values of its elements and its mesh currents, which replaces the previous one
+ * atomically. The requests can't change the meshes, branches and IDs of a circuit,
+ * so the versions share them instead of copying them. Queries
+ * read the last version published, without taking the lock of the circuit, so they
+ * never wait for the changes and solves of other clients, and all the results of a
+ * query come from the same version, whose number is answered with them. A version is
+ * released once no query reads it.
+ */
+class SolverServer {
+
+    private:
+        std::string m_path;                             // The path of the socket
+        int m_listener = -1;                            // The socket that accepts the clients
+        std::atomic<bool> m_stopping{false};            // true once a client asks the server to stop
+
+        std::mutex m_lock;                              // Taken to use the members below
+        std::unordered_map<uint32_t, std::shared_ptr<ServedCircuit>> m_circuits; // The loaded circuits
+        uint32_t m_nextCircuit = 1;                     // The number of the next circuit loaded
+        std::vector<int> m_clients;                     // The sockets of the connected clients
+        std::mutex m_threadsLock;                       // Taken to count the threads of the clients
+        std::condition_variable m_threadsFinished;      // Notified when the thread of a client ends
+        size_t m_activeThreads = 0;                     // The number of threads of clients running
+
+        std::string m_error = "";                       // The description of the last error
+
+        /*!
+        * \brief Function that serves the requests of a client until it disconnects.
+        */
+        void serve(int t_client);
+
+        /*!
+        * \brief Function that runs a request and writes its answer.
+        *
+        * \return false if the answer is an error
+        */
+        bool handle(ServerCommand t_command, const std::vector<char> &t_request, std::vector<char> &t_answer);
+
+        /*!
+        * \brief Function that returns a loaded circuit, or nullptr.
+        */
+        std::shared_ptr<ServedCircuit> find(uint32_t t_circuit);
+
+    public:
+        SolverServer() = default;
+        SolverServer(const SolverServer &) = delete;
+        SolverServer &operator=(const SolverServer &) = delete;
+
+        /*!
+        * \brief Destructor.
+        *
+        * Closes the socket and removes its file.
+        */
+        ~SolverServer();
+
+        /*!
+        * \brief Function that creates the socket of the server.
+        *
+        * A socket left at the path by a previous server is replaced.
+        *
+        * \param t_path The path of the socket
+        *
+        * \return true if the socket was created, false otherwise (see getError)
+        */
+        bool open(const std::string &t_path);
+
+        /*!
+        * \brief Function that serves the clients until one of them asks the server to stop.
+        */
+        void run();
+
+        /*!
+        * \brief Function that returns the description of the last error.
+        *
+        * \return The error description
+        */
+        const std::string &getError() const {
+            return m_error;
+        }
+
+};
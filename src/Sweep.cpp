@@ -0,0 +1,204 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Sweep.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to solve a circuit
+ * for many values of some of its elements.
+ */
+
+#include <cmath>
+#include "Sweep.h"
+#include "CircuitEditor.h"
+#include "Log.h"
+#include "ValueParser.h"
+
+using namespace std;
+
+namespace {
+
+    /*!
+    * \brief A result written for every point of a sweep.
+    */
+    struct SweepColumn {
+        enum { Mesh, Branch, Element } item; // What the index refers to
+        uint32_t index;                     // The index of the mesh, branch or element
+    };
+}
+
+
+bool parseSweep(string_view text, SweepParameter &parameter) {
+    size_t equals = text.find('=');
+    if (equals == string_view::npos || equals == 0)
+        return false;
+    parameter.elementID = string(text.substr(0, equals));
+    parameter.values.clear();
+    string_view values = text.substr(equals + 1);
+
+    // A range start:stop:count
+    size_t first_colon = values.find(':');
+    if (first_colon != string_view::npos) {
+        size_t second_colon = values.find(':', first_colon + 1);
+        double start, stop, count;
+        if (second_colon == string_view::npos || !parseValue(values.substr(0, first_colon), start) ||
+            !parseValue(values.substr(first_colon + 1, second_colon - first_colon - 1), stop) ||
+            !parseValue(values.substr(second_colon + 1), count) || count < 1 || count != floor(count))
+            return false;
+        size_t points = static_cast<size_t>(count);
+        for (size_t i = 0; i < points; i++)
+            parameter.values.push_back(points == 1 ? start : start + (stop - start) * i / (points - 1));
+        return true;
+    }
+
+    // A list of values
+    while (true) {
+        size_t comma = values.find(',');
+        double value;
+        if (!parseValue(values.substr(0, comma), value))
+            return false;
+        parameter.values.push_back(value);
+        if (comma == string_view::npos)
+            return true;
+        values.remove_prefix(comma + 1);
+    }
+}
+
+
+bool runSweep(CircuitContext &context, const vector<SweepParameter> &parameters, const ResultsOptions &options,
+    const string &fileName) {
+    // The results of each point are computed from the mesh currents if there are probes
+    context.deferResults = !options.probeIDs.empty();
+    CircuitEditor editor(context);
+    CircuitView circuit = context.view();
+    const CircuitModel &model = context.model;
+
+    size_t points = 1;
+    for (const SweepParameter &parameter : parameters) {
+        if (model.findElement(parameter.elementID) == NOT_FOUND) {
+            logMessage(LogLevel::Error, "ERROR: There is no element with ID ", parameter.elementID);
+            return false;
+        }
+        points *= parameter.values.size();
+    }
+
+    // Choose the results written for each point
+    vector<SweepColumn> columns;
+    if (context.deferResults) {
+        vector<string> missing;
+        Probes probes = findProbes(circuit, options.probeIDs, missing);
+        for (const string &ID : missing)
+            logMessage(LogLevel::Error, "WARNING: There is no mesh, branch or element with ID ", ID);
+        for (uint32_t i : probes.meshes)
+            columns.push_back({SweepColumn::Mesh, i});
+        for (uint32_t b : probes.branches)
+            columns.push_back({SweepColumn::Branch, b});
+        for (uint32_t e : probes.elements)
+            columns.push_back({SweepColumn::Element, e});
+    } else {
+        for (uint32_t i = 0; i < circuit.meshCount && options.fields.meshes; i++)
+            columns.push_back({SweepColumn::Mesh, i});
+        for (uint32_t b = 0; b < circuit.branchCount && options.fields.branches; b++)
+            columns.push_back({SweepColumn::Branch, b});
+        for (uint32_t e = 0; e < circuit.elementCount && options.fields.elements; e++) {
+            if (circuit.elementKinds[e] == ElementKind::Resistance)
+                columns.push_back({SweepColumn::Element, e});
+        }
+    }
+
+    // The branches whose currents the columns need, computed together at each point
+    // from the meshes that traverse them, which the sweep does not change
+    vector<uint32_t> branches;
+    for (const SweepColumn &column : columns) {
+        if (column.item == SweepColumn::Branch)
+            branches.push_back(column.index);
+        else if (column.item == SweepColumn::Element)
+            branches.push_back(model.elementBranch(column.index));
+    }
+    BranchMeshes branch_meshes;
+    if (context.deferResults)
+        branch_meshes = findBranchMeshes(circuit);
+
+    ResultsWriter writer;
+    if (!writer.open(fileName)) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+
+    // Write the header line
+    for (size_t p = 0; p < parameters.size(); p++)
+        writer.text(p > 0 ? "," : "").csvField(parameters[p].elementID);
+    for (const SweepColumn &column : columns) {
+        if (column.item == SweepColumn::Mesh)
+            writer.text(",").csvField(string(circuit.string(circuit.meshIDs[column.index])) + " (A)");
+        else if (column.item == SweepColumn::Branch)
+            writer.text(",").csvField(string(circuit.string(circuit.branchIDs[column.index])) + " (A)");
+        else
+            writer.text(",").csvField(string(circuit.string(circuit.elementIDs[column.index])) + " (W)");
+    }
+    writer.text("\n");
+
+    // Visit every combination of values, the last parameter varying the fastest
+    vector<size_t> positions(parameters.size(), 0);
+    vector<double> values(parameters.size(), NAN);
+    for (size_t point = 0; point < points; point++) {
+        // Only the values that changed are edited, so the system is updated as little as possible
+        for (size_t p = 0; p < parameters.size(); p++) {
+            double value = parameters[p].values[positions[p]];
+            if (value != values[p] && !editor.setValue(parameters[p].elementID, value)) {
+                logMessage(LogLevel::Error, "ERROR: ", editor.getError());
+                return false;
+            }
+            values[p] = value;
+            writer.number(value).text(p + 1 < parameters.size() ? "," : "");
+        }
+
+        if (!editor.solve()) {
+            logMessage(LogLevel::Error, "WARNING: The circuit can't be solved at the point ", point + 1,
+                ", its impedance matrix is singular");
+            for (size_t c = 0; c < columns.size(); c++)
+                writer.text(",");
+        } else {
+            CircuitResults &results = context.results;
+            ResultsView view(circuit, results.meshCurrents, results.branchCurrents, results.elementPowers,
+                &branch_meshes);
+            view.evaluate(branches);
+            for (const SweepColumn &column : columns) {
+                writer.text(",");
+                if (column.item == SweepColumn::Mesh)
+                    writer.number(view.meshCurrent(column.index));
+                else if (column.item == SweepColumn::Branch)
+                    writer.number(view.branchCurrent(column.index));
+                else
+                    writer.number(view.elementPower(column.index));
+            }
+        }
+        writer.text("\n");
+
+        for (size_t p = parameters.size(); p-- > 0;) {
+            if (++positions[p] < parameters[p].values.size())
+                break;
+            positions[p] = 0;
+        }
+    }
+    if (!writer.close()) {
+        logMessage(LogLevel::Error, "ERROR: There were problems writing ", fileName);
+        return false;
+    }
+    return true;
+}
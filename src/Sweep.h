@@ -0,0 +1,78 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file Sweep.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to solve a circuit
+ * for many values of some of its elements.
+ */
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CircuitSolver.h"
+
+
+/*!
+ * \brief An element whose value is swept, with the values it takes.
+ */
+struct SweepParameter {
+    std::string elementID;              // The element ID
+    std::vector<double> values;         // The values of the element (Ω or V)
+};
+
+/*!
+* \brief Function that reads a swept element and its values.
+* 
+* The text is the element ID, an equals sign, and either a comma separated list of
+* values or a range start:stop:count of count values evenly spaced from start to stop.
+* Values may use the engineering suffixes of the circuit files.
+* 
+* \param t_text The text of the parameter, such as resistance-1=1k:10k:10
+* \param t_parameter The parameter read
+* 
+* \return true if the text is valid, false otherwise
+*/
+bool parseSweep(std::string_view t_text, SweepParameter &t_parameter);
+
+/*!
+* \brief Function that solves a circuit for every combination of the values of some elements.
+* 
+* The system of the circuit is built once and edited with a CircuitEditor between
+* points, so a point whose batteries change only takes a triangular solve with the kept
+* factorization, and a point whose resistances change only factorizes again the
+* columns of the meshes after the first mesh of the changed resistances. The last
+* parameter varies the fastest, so the resistances that change less should go first.
+* 
+* Every point is written as a line of a CSV file: the values of the parameters,
+* followed by the currents of the meshes and branches (A) and the powers of the
+* resistances (W) chosen by the options, or of the probes of the options if it has
+* any. A point whose circuit can't be solved is written without results. Any problem
+* is reported.
+* 
+* \param t_context The context of the loaded circuit, which is edited
+* \param t_parameters The swept elements
+* \param t_options The results to write for each point
+* \param t_fileName The name of the CSV file
+* 
+* \return true if every point was written, false otherwise
+*/
+bool runSweep(CircuitContext &t_context, const std::vector<SweepParameter> &t_parameters,
+    const ResultsOptions &t_options, const std::string &t_fileName);
@@ -0,0 +1,149 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ValueParser.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the function required to decode the
+ * numeric values of the circuit elements.
+ */
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include "ValueParser.h"
+
+using namespace std;
+
+namespace {
+
+    /*!
+    * \brief An engineering suffix and the power of ten it stands for.
+    */
+    struct Suffix {
+        const char *text;
+        int exponent;
+    };
+
+    // The longest suffixes go first, so "meg" is not taken as "m"
+    const Suffix SUFFIXES[] = {
+        {"meg", 6}, {"Meg", 6}, {"MEG", 6}, {"\xC2\xB5", -6},
+        {"f", -15}, {"p", -12}, {"n", -9}, {"u", -6}, {"m", -3}, {"R", 0},
+        {"k", 3}, {"K", 3}, {"M", 6}, {"G", 9}, {"T", 12}
+    };
+
+    // The size of the buffer used to rewrite a value with a suffix
+    const size_t BUFFER_SIZE = 64;
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+}
+
+
+bool parseValue(string_view text, double &value) {
+
+    // Trim the text
+    const char *first = text.data();
+    const char *last = text.data() + text.size();
+    while (first < last && isSpace(*first))
+        first++;
+    while (last > first && isSpace(*(last - 1)))
+        last--;
+
+    // from_chars does not accept an explicit plus sign
+    const char *number = first;
+    if (number < last && *number == '+')
+        number++;
+    if (number == last || (*number == '-' && number != first))
+        return false;
+
+    // Decode the number. from_chars is locale-independent and rounds correctly
+    double result;
+    auto decoded = from_chars(number, last, result);
+    if (decoded.ec != errc())
+        return false;
+    // from_chars also accepts "inf" and "nan", which are not values of an element
+    if (!isfinite(result))
+        return false;
+    if (decoded.ptr == last) {
+        value = result;
+        return true;
+    }
+
+    // Look for an engineering suffix right after the number
+    const char *suffix_end = nullptr;
+    int exponent = 0;
+    for (auto &suffix : SUFFIXES) {
+        size_t length = strlen(suffix.text);
+        if (static_cast<size_t>(last - decoded.ptr) >= length && memcmp(decoded.ptr, suffix.text, length) == 0) {
+            suffix_end = decoded.ptr + length;
+            exponent = suffix.exponent;
+            break;
+        }
+    }
+    if (suffix_end == nullptr)
+        return false;
+
+    // The digits after the suffix, if any, are the decimals of a code like "4k7",
+    // which is only valid if the number before the suffix is an integer
+    const char *decimals = suffix_end;
+    while (suffix_end < last && isDigit(*suffix_end))
+        suffix_end++;
+    if (suffix_end != last)
+        return false;
+    bool integer = true;
+    for (const char *c = number; c < decoded.ptr; c++) {
+        if (!isDigit(*c) && *c != '-')
+            integer = false;
+    }
+    if (decimals != last && !integer)
+        return false;
+    // A suffix after an exponent ("1e3k") is ambiguous
+    if (memchr(number, 'e', decoded.ptr - number) != nullptr || memchr(number, 'E', decoded.ptr - number) != nullptr)
+        return false;
+
+    // Rewrite the value in scientific notation and decode it again, so the
+    // result is correctly rounded (220e-3 instead of 220 * 0.001)
+    char buffer[BUFFER_SIZE];
+    size_t mantissa_length = decoded.ptr - number;
+    size_t decimals_length = last - decimals;
+    if (mantissa_length + decimals_length + 8 > BUFFER_SIZE)
+        return false;
+    char *end = buffer;
+    memcpy(end, number, mantissa_length);
+    end += mantissa_length;
+    if (decimals_length > 0) {
+        *end++ = '.';
+        memcpy(end, decimals, decimals_length);
+        end += decimals_length;
+    }
+    *end++ = 'e';
+    end = to_chars(end, buffer + BUFFER_SIZE, exponent).ptr;
+    decoded = from_chars(buffer, end, result);
+    if (decoded.ec != errc() || decoded.ptr != end || !isfinite(result))
+        return false;
+
+    value = result;
+    return true;
+}
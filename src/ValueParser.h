@@ -0,0 +1,50 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file ValueParser.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the function required to decode the
+ * numeric values of the circuit elements.
+ */
+
+#pragma once
+#include <string_view>
+
+
+/*!
+* \brief Function that decodes an element value.
+*
+* The value is decoded in a single pass and does not depend on the locale, so
+* the decimal separator is always a point. Besides plain numbers ("4700", "4.7e3"),
+* it accepts the engineering suffixes used by SPICE netlists and resistor codes:
+*
+* f (1e-15), p (1e-12), n (1e-9), u or µ (1e-6), m (1e-3), R (1), k or K (1e3),
+* M or meg (1e6), G (1e9) and T (1e12).
+*
+* The suffix may follow the number ("220m", "10M", "1.5k") or replace its decimal
+* point ("4k7" is 4700, "4R7" is 4.7). Note that, unlike SPICE, suffixes are case
+* sensitive, so "m" is milli and "M" is mega. Infinities and NaN ("inf", "nan")
+* are not valid values.
+*
+* \param t_text The text to be decoded
+* \param t_value The decoded value, only modified if the text is valid
+*
+* \return true if the text is a valid value, false otherwise
+*/
+bool parseValue(std::string_view t_text, double &t_value);
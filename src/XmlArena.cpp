@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file XmlArena.cpp
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the implementation of the functions required to allocate the
+ * XML documents from a per-thread arena.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "pugixml.hpp"
+#include "XmlArena.h"
+
+using namespace std;
+
+namespace {
+
+    // Size of the first block of each arena (bytes)
+    const size_t ARENA_BLOCK_SIZE = 256 * 1024;
+
+    // Largest block kept by an arena after it is reset (bytes)
+    const size_t ARENA_RETAINED_SIZE = 64 * 1024 * 1024;
+
+    // Alignment of every allocation, enough for any type stored by pugixml
+    const size_t ARENA_ALIGNMENT = alignof(max_align_t);
+
+    /*!
+    * \brief A block of memory of an arena.
+    */
+    struct Block {
+        unique_ptr<char[]> data;    // The memory of the block
+        size_t size;                // The size of the block (bytes)
+    };
+
+    /*!
+    * \brief A bump allocator made of a list of blocks.
+    */
+    struct Arena {
+        vector<Block> blocks;       // The blocks of the arena, in the order they are used
+        size_t current = 0;         // The block allocations are taken from
+        size_t used = 0;            // The bytes taken from the current block
+
+        void *allocate(size_t size) {
+            size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+            // Move to the next block that is large enough, adding one if there is none
+            while (current < blocks.size() && used + size > blocks[current].size) {
+                current++;
+                used = 0;
+            }
+            if (current == blocks.size()) {
+                size_t block_size = blocks.empty() ? ARENA_BLOCK_SIZE : 2 * blocks.back().size;
+                if (block_size < size)
+                    block_size = size;
+                blocks.push_back(Block{unique_ptr<char[]>(new (nothrow) char[block_size]), block_size});
+                if (!blocks.back().data) {
+                    blocks.pop_back();
+                    return nullptr;
+                }
+            }
+
+            void *pointer = blocks[current].data.get() + used;
+            used += size;
+            return pointer;
+        }
+
+        void reset() {
+            // Replace several blocks by a single one that holds all of them, so the
+            // next document of the same size takes a single block
+            size_t total = 0;
+            for (auto &block : blocks)
+                total += block.size;
+            if (blocks.size() > 1 || total > ARENA_RETAINED_SIZE) {
+                blocks.clear();
+                if (total <= ARENA_RETAINED_SIZE)
+                    blocks.push_back(Block{unique_ptr<char[]>(new (nothrow) char[total]), total});
+                if (!blocks.empty() && !blocks.back().data)
+                    blocks.clear();
+            }
+            current = 0;
+            used = 0;
+        }
+    };
+
+    thread_local Arena arena;
+
+    void *allocate(size_t size) {
+        return arena.allocate(size);
+    }
+
+    void deallocate(void *) {
+        // The memory is reused when the arena is reset
+    }
+
+}
+
+
+void installXmlArena() {
+    pugi::set_memory_management_functions(allocate, deallocate);
+}
+
+
+void resetXmlArena() {
+    arena.reset();
+}
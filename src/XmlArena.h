@@ -0,0 +1,45 @@
+/* --------------------------------------------------------------------------------*\
+Copyright 2019 Víctor A Auñón
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. 
+\*--------------------------------------------------------------------------------*/
+
+/**
+ * @file XmlArena.h
+ * @author Víctor A. Auñón <hola@victoraunon.com>
+ *
+ * @section DESCRIPTION
+ * This file includes the declaration of the functions required to allocate the
+ * XML documents from a per-thread arena.
+ */
+
+#pragma once
+
+
+/*!
+* \brief Function that makes pugixml allocate every document from the arena of its thread.
+* 
+* Each thread gets its own arena, so threads that parse at once do not contend for
+* the heap. Memory freed by pugixml is not reused until the arena is reset. It must
+* be called once, before any document is created.
+*/
+void installXmlArena();
+
+/*!
+* \brief Function that resets the arena of the calling thread.
+* 
+* Every document created by this thread must have been destroyed. The memory is kept
+* for the next document, so reading a sequence of files of similar size does not
+* allocate after the first one. Only very large blocks are given back to the heap.
+*/
+void resetXmlArena();